@@ -0,0 +1,27 @@
+#include "CountingResource.h"
+
+CountingResource::CountingResource(std::pmr::memory_resource* upstream)
+   : m_upstream(upstream)
+   , m_bytesInUse(0)
+   , m_peakBytes(0)
+   , m_allocationCount(0)
+{
+}
+
+void* CountingResource::do_allocate(size_t bytes, size_t alignment)
+{
+   void* pointer = m_upstream->allocate(bytes, alignment);
+   m_allocationCount.fetch_add(1, std::memory_order_relaxed);
+   const size_t bytesInUse = m_bytesInUse.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+   size_t peakBytes = m_peakBytes.load(std::memory_order_relaxed);
+   while (peakBytes < bytesInUse && !m_peakBytes.compare_exchange_weak(peakBytes, bytesInUse, std::memory_order_relaxed))
+   {
+   }
+   return pointer;
+}
+
+void CountingResource::do_deallocate(void* pointer, size_t bytes, size_t alignment)
+{
+   m_upstream->deallocate(pointer, bytes, alignment);
+   m_bytesInUse.fetch_sub(bytes, std::memory_order_relaxed);
+}
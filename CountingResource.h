@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+/// <summary>
+/// Memory resource passing allocations to an upstream one and counting them, e.g. to report
+/// the memory of a dictionary or of the per-call scratch buffers separately.
+/// Thread-safe if the upstream resource is
+/// </summary>
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+   explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+   /// <summary>
+   /// Bytes allocated and not deallocated yet
+   /// </summary>
+   size_t GetBytesInUse() const { return m_bytesInUse.load(std::memory_order_relaxed); }
+
+   /// <summary>
+   /// The most bytes in use at once since the creation or <c>ResetPeak</c>
+   /// </summary>
+   size_t GetPeakBytes() const { return m_peakBytes.load(std::memory_order_relaxed); }
+
+   /// <summary>
+   /// Number of allocations since the creation
+   /// </summary>
+   size_t GetAllocationCount() const { return m_allocationCount.load(std::memory_order_relaxed); }
+
+   /// <summary>
+   /// Starts tracking the peak from the bytes in use now
+   /// </summary>
+   void ResetPeak() { m_peakBytes.store(GetBytesInUse(), std::memory_order_relaxed); }
+
+   std::pmr::memory_resource* GetUpstream() const { return m_upstream; }
+
+private:
+   CountingResource(const CountingResource&) = delete;
+   CountingResource& operator =(const CountingResource&) = delete;
+
+   void* do_allocate(size_t bytes, size_t alignment) override;
+   void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+   bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+   std::pmr::memory_resource* m_upstream;
+   std::atomic<size_t> m_bytesInUse;
+   std::atomic<size_t> m_peakBytes;
+   std::atomic<size_t> m_allocationCount;
+};
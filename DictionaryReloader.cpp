@@ -0,0 +1,98 @@
+#include "DictionaryReloader.h"
+#include "InputBuffer.h"
+
+DictionaryReloader::DictionaryReloader(TextSpellChecker& checker)
+   : m_checker(checker)
+   , m_isReloading(false)
+{
+}
+
+DictionaryReloader::~DictionaryReloader()
+{
+   Wait();
+}
+
+bool DictionaryReloader::Reload(std::string path, ReloadCallback onReloaded)
+{
+   // concurrent calls race for the flag, only the winner starts a reload
+   bool isReloading = false;
+   if (!m_isReloading.compare_exchange_strong(isReloading, true, std::memory_order_acquire))
+   {
+      return false;
+   }
+
+   // the last reload thread may release the flag before its caller has stored it
+   std::lock_guard<std::mutex> lock(m_threadMutex);
+   join();
+   if (!m_replaced.expired())
+   {
+      m_isReloading.store(false, std::memory_order_release);
+      return false;
+   }
+   m_thread = std::thread([this, path=std::move(path), onReloaded=std::move(onReloaded)]()
+   {
+      const auto report = reload(path);
+      m_isReloading.store(false, std::memory_order_release);
+      onReloaded(report);
+   });
+   return true;
+}
+
+void DictionaryReloader::Wait()
+{
+   std::lock_guard<std::mutex> lock(m_threadMutex);
+   join();
+}
+
+void DictionaryReloader::join()
+{
+   if (m_thread.joinable())
+   {
+      m_thread.join();
+   }
+}
+
+DictionaryReloader::Report DictionaryReloader::reload(const std::string& path)
+{
+   Report report;
+   InputBuffer input;
+   if (!input.Open(path.c_str()))
+   {
+      return report;
+   }
+
+   trie::StringViewVec words;
+   LineReader reader(input.GetData());
+   for (std::string_view line; reader.NextLine(line);)
+   {
+      ForEachWord(line, [&words](std::string_view word)
+      {
+         words.push_back(word);
+         return true;
+      });
+   }
+
+   // the new dictionary is allocated and runs like the old one
+   const auto current = m_checker.GetWordChecker();
+   auto wordChecker = std::make_shared<WordSpellChecker>(current->GetDictionary().GetMemoryResource());
+   wordChecker->AddWords(words.begin(), words.end());
+
+   if (current->GetWorkerPool())
+   {
+      wordChecker->SetWorkerPool(current->GetWorkerPool());
+      if (current->IsDictionaryReplicated())
+      {
+         wordChecker->ReplicateDictionary();
+      }
+   }
+
+   report.isReloaded = true;
+   report.wordCount = wordChecker->GetDictionary().GetWordCount();
+   report.dictionaryBytes = wordChecker->MemoryUsage();
+
+   const auto replaced = m_checker.ReplaceDictionary(std::move(wordChecker));
+   report.peakBytes = report.dictionaryBytes + replaced->MemoryUsage() +
+      input.GetData().size() + words.capacity() * sizeof(words[0]);
+   m_replaced = replaced;
+   return report;
+}
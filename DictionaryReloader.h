@@ -0,0 +1,77 @@
+#pragma once
+
+#include "TextSpellChecker.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/// <summary>
+/// Reloads the dictionary of a checker from a file of whitespace separated words without stopping checks.
+/// The new dictionary is built in the background and swapped in, checks in flight finish with the old one.
+/// At most two dictionaries are alive: a reload is refused while the one replaced before is still in use
+/// </summary>
+class DictionaryReloader
+{
+public:
+   struct Report
+   {
+      /// <summary>
+      /// false if the file can't be read, the dictionary is kept then
+      /// </summary>
+      bool isReloaded = false;
+      size_t wordCount = 0;
+
+      /// <summary>
+      /// Memory of the new dictionary and its copies
+      /// </summary>
+      size_t dictionaryBytes = 0;
+
+      /// <summary>
+      /// Memory held at the swap: the old and the new dictionaries, the file and the word list
+      /// </summary>
+      size_t peakBytes = 0;
+   };
+
+   using ReloadCallback = std::function<void(const Report&)>;
+
+   explicit DictionaryReloader(TextSpellChecker& checker);
+
+   /// <summary>
+   /// Waits for the reload in progress
+   /// </summary>
+   ~DictionaryReloader();
+
+   /// <summary>
+   /// Starts reloading the dictionary on a background thread, may be called from many threads
+   /// </summary>
+   /// <param name="path">dictionary file</param>
+   /// <param name="onReloaded">called on the background thread when the new dictionary is swapped in,
+   /// must not start another reload</param>
+   /// <returns>false if a reload is in progress or the dictionary replaced before is still in use</returns>
+   bool Reload(std::string path, ReloadCallback onReloaded);
+
+   /// <summary>
+   /// Waits for the reload in progress
+   /// </summary>
+   void Wait();
+
+private:
+   DictionaryReloader(const DictionaryReloader&) = delete;
+   DictionaryReloader& operator =(const DictionaryReloader&) = delete;
+
+   Report reload(const std::string& path);
+   void join();
+
+   TextSpellChecker& m_checker;
+   std::mutex m_threadMutex;
+   std::thread m_thread;
+   std::atomic<bool> m_isReloading;
+
+   /// <summary>
+   /// The dictionary replaced by the last reload, alive while checks use it
+   /// </summary>
+   std::weak_ptr<const WordSpellChecker> m_replaced;
+};
@@ -0,0 +1,142 @@
+#include "InputBuffer.h"
+
+#ifdef _WIN32
+#include <fstream>
+#include <sstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+InputBuffer::InputBuffer()
+   : m_mapping(nullptr)
+   , m_mappingSize(0)
+{
+}
+
+InputBuffer::~InputBuffer()
+{
+   close();
+}
+
+#ifdef _WIN32
+
+bool InputBuffer::Open(const char* path)
+{
+   close();
+   std::ifstream file(path, std::ios::binary);
+   if (!file.is_open())
+   {
+      return false;
+   }
+   std::ostringstream contents;
+   contents << file.rdbuf();
+   m_buffer = contents.str();
+   m_data = m_buffer;
+   return true;
+}
+
+void InputBuffer::close()
+{
+   m_buffer.clear();
+   m_data = {};
+}
+
+#else
+
+bool InputBuffer::Open(const char* path)
+{
+   close();
+   const int fileDescriptor = ::open(path, O_RDONLY);
+   if (fileDescriptor < 0)
+   {
+      return false;
+   }
+
+   struct stat fileStat {};
+   bool isRead = false;
+   if (::fstat(fileDescriptor, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0)
+   {
+      isRead = map(fileDescriptor, static_cast<size_t>(fileStat.st_size));
+   }
+   if (!isRead)
+   {
+      isRead = read(fileDescriptor);
+   }
+   ::close(fileDescriptor);
+   return isRead;
+}
+
+bool InputBuffer::map(int fileDescriptor, size_t size)
+{
+   void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+   if (mapping == MAP_FAILED)
+   {
+      return false;
+   }
+   ::madvise(mapping, size, MADV_SEQUENTIAL);
+   m_mapping = mapping;
+   m_mappingSize = size;
+   m_data = std::string_view(static_cast<const char*>(mapping), size);
+   return true;
+}
+
+bool InputBuffer::read(int fileDescriptor)
+{
+   const size_t chunkSize = 64 * 1024;
+   for (;;)
+   {
+      const size_t oldSize = m_buffer.size();
+      m_buffer.resize(oldSize + chunkSize);
+      const auto readBytes = ::read(fileDescriptor, &m_buffer[oldSize], chunkSize);
+      if (readBytes < 0)
+      {
+         m_buffer.clear();
+         return false;
+      }
+      m_buffer.resize(oldSize + static_cast<size_t>(readBytes));
+      if (readBytes == 0)
+      {
+         break;
+      }
+   }
+   m_data = m_buffer;
+   return true;
+}
+
+void InputBuffer::close()
+{
+   if (m_mapping)
+   {
+      ::munmap(m_mapping, m_mappingSize);
+      m_mapping = nullptr;
+      m_mappingSize = 0;
+   }
+   m_buffer.clear();
+   m_data = {};
+}
+
+#endif
+
+bool LineReader::NextLine(std::string_view& line)
+{
+   if (m_pos >= m_text.size())
+   {
+      return false;
+   }
+
+   const auto endOfLine = m_text.find('\n', m_pos);
+   if (endOfLine == std::string_view::npos)
+   {
+      line = m_text.substr(m_pos);
+      m_pos = m_text.size();
+   }
+   else
+   {
+      line = m_text.substr(m_pos, endOfLine - m_pos);
+      m_pos = endOfLine + 1;
+   }
+   return true;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+/// <summary>
+/// The whole input file in memory: memory-mapped for regular files,
+/// read with a buffered read() loop otherwise (pipes, character devices)
+/// </summary>
+class InputBuffer
+{
+public:
+   InputBuffer();
+   ~InputBuffer();
+
+   /// <summary>
+   /// Maps or reads the file
+   /// </summary>
+   /// <param name="path">file path</param>
+   /// <returns>false if the file can't be opened or read</returns>
+   bool Open(const char* path);
+
+   /// <summary>
+   /// File contents, valid while the buffer lives
+   /// </summary>
+   std::string_view GetData() const { return m_data; }
+
+   /// <summary>
+   /// Is the file memory-mapped or read to memory
+   /// </summary>
+   bool IsMapped() const { return m_mapping != nullptr; }
+
+private:
+   InputBuffer(const InputBuffer&) = delete;
+   InputBuffer& operator =(const InputBuffer&) = delete;
+
+   bool map(int fileDescriptor, size_t size);
+   bool read(int fileDescriptor);
+   void close();
+
+   void* m_mapping;
+   size_t m_mappingSize;
+
+   /// <summary>
+   /// Contents read without mapping
+   /// </summary>
+   std::string m_buffer;
+
+   std::string_view m_data;
+};
+
+/// <summary>
+/// Splits text into lines in place
+/// </summary>
+class LineReader
+{
+public:
+   explicit LineReader(std::string_view text)
+      : m_text(text)
+      , m_pos(0)
+   {
+   }
+
+   /// <summary>
+   /// Reads the next line
+   /// </summary>
+   /// <param name="line">line without the end of line symbol</param>
+   /// <returns>false if the end of text is reached</returns>
+   bool NextLine(std::string_view& line);
+
+   /// <summary>
+   /// Position of the next line in the text
+   /// </summary>
+   size_t GetPosition() const { return m_pos; }
+
+private:
+   std::string_view m_text;
+   size_t m_pos;
+};
+
+/// <summary>
+/// Splits a line into whitespace separated words in place
+/// </summary>
+/// <param name="line">line without the end of line symbol</param>
+/// <param name="onWord">function called for every word, returns false to stop</param>
+/// <returns>false if stopped</returns>
+template<typename Fn>
+bool ForEachWord(std::string_view line, Fn onWord)
+{
+   const auto isSpace = [](char symbol)
+   {
+      return symbol == ' ' || ('\t' <= symbol && symbol <= '\r');
+   };
+
+   for (size_t pos = 0; pos < line.size();)
+   {
+      if (isSpace(line[pos]))
+      {
+         ++pos;
+         continue;
+      }
+      const size_t start = pos;
+      while (pos < line.size() && !isSpace(line[pos]))
+      {
+         ++pos;
+      }
+      if (!onWord(line.substr(start, pos - start)))
+      {
+         return false;
+      }
+   }
+   return true;
+}
@@ -1,14 +1,75 @@
 #include "TextSpellChecker.h"
+#include "Unicode.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 
 namespace
 {
 
-bool isLetter(char symbol)
+/// <summary>
+/// Initial scratch buffer of a text, fits the masks of words up to 14 letters
+/// </summary>
+const size_t gc_scratchBufferSize = 64 * 1024;
+
+/// <summary>
+/// Uninitialized memory of a resource, freed at scope exit
+/// </summary>
+class ScratchBuffer
 {
-   return ('a' <= symbol && symbol <= 'z') ||
-          ('A' <= symbol && symbol <= 'Z');
+public:
+   ScratchBuffer(size_t size, std::pmr::memory_resource* resource)
+      : m_resource(resource)
+      , m_size(size)
+      , m_data(resource->allocate(size))
+   {
+   }
+
+   ~ScratchBuffer()
+   {
+      m_resource->deallocate(m_data, m_size);
+   }
+
+   void* GetData() const { return m_data; }
+   size_t GetSize() const { return m_size; }
+
+private:
+   ScratchBuffer(const ScratchBuffer&) = delete;
+   ScratchBuffer& operator =(const ScratchBuffer&) = delete;
+
+   std::pmr::memory_resource* m_resource;
+   size_t m_size;
+   void* m_data;
+};
+
+/// <summary>
+/// Reads a symbol: an ASCII char or a UTF-8 sequence
+/// </summary>
+/// <param name="text"></param>
+/// <param name="pos">position of the symbol, moved to the next one</param>
+/// <returns>true if the symbol is a letter</returns>
+bool readSymbol(std::string_view text, size_t& pos)
+{
+   const char symbol = text[pos];
+   if (unicode::IsAscii(symbol))
+   {
+      ++pos;
+      return unicode::IsAsciiLetter(symbol);
+   }
+   return unicode::IsLetter(unicode::Decode(text, pos));
+}
+
+bool isCapitalized(const std::string& word)
+{
+   if (word.empty())
+      return false;
+
+   if (unicode::IsAscii(word[0]))
+      return !std::islower(static_cast<unsigned char>(word[0]));
+
+   size_t pos = 0;
+   const auto letter = unicode::Decode(word, pos);
+   return unicode::ToLower(letter) != letter;
 }
 
 std::string recoverCapital(const std::string& word, bool isCapital)
@@ -17,11 +78,22 @@ std::string recoverCapital(const std::string& word, bool isCapital)
       return word;
 
    auto capitalizedWord(word);
-   capitalizedWord[0] = static_cast<char>(std::toupper(capitalizedWord[0]));
+   if (unicode::IsAscii(word[0]))
+   {
+      capitalizedWord[0] = static_cast<char>(std::toupper(capitalizedWord[0]));
+      return capitalizedWord;
+   }
+
+   size_t pos = 0;
+   const auto letter = unicode::Decode(word, pos);
+   capitalizedWord.clear();
+   unicode::Append(capitalizedWord, unicode::ToUpper(letter));
+   capitalizedWord.append(word, pos, std::string::npos);
    return capitalizedWord;
 }
 
-std::string join(const WordSpellChecker::StringSet& words, bool isCapital)
+template<typename Words>
+std::string join(const Words& words, bool isCapital)
 {
    if (words.empty())
       return {};
@@ -42,9 +114,10 @@ std::string join(const WordSpellChecker::StringSet& words, bool isCapital)
    return res;
 }
 
-std::string outputCorrection(const std::string& word, const WordSpellChecker::SpellCheckingRes& corrections)
+template<typename Words>
+std::string outputCorrection(const std::string& word, const std::pair<WordSpellChecker::Correction, Words>& corrections)
 {
-   const bool isCapital = !word.empty() ? !std::islower(word[0]) : false;
+   const bool isCapital = isCapitalized(word);
    const auto& [correctionType, suggestions] = corrections;
    switch (correctionType)
    {
@@ -75,7 +148,7 @@ std::string outputCorrection(const std::string& word, const WordSpellChecker::Sp
 
 }
 
-TextSpellChecker::TokenVec TextSpellChecker::tokenize(const std::string& text)
+TextSpellChecker::TokenVec TextSpellChecker::tokenize(std::string_view text)
 {
    enum class State
    {
@@ -88,20 +161,22 @@ TextSpellChecker::TokenVec TextSpellChecker::tokenize(const std::string& text)
    std::string tokenText;
    TokenVec tokens;
 
-   for (auto pos = text.cbegin(); pos != text.cend(); ++pos)
+   for (size_t pos = 0; pos < text.size();)
    {
-      const char curSymbol = *pos;
+      const size_t symbolPos = pos;
+      const bool isLetter = readSymbol(text, pos);
+      const auto curSymbol = text.substr(symbolPos, pos - symbolPos);
       switch (state)
       {
       case State::Start:
       {
-         state = isLetter(curSymbol) ? State::InWord : State::InOther;
+         state = isLetter ? State::InWord : State::InOther;
          tokenText += curSymbol;
          break;
       }
       case State::InWord:
       {
-         if (isLetter(curSymbol))
+         if (isLetter)
          {
             tokenText += curSymbol;
          }
@@ -115,7 +190,7 @@ TextSpellChecker::TokenVec TextSpellChecker::tokenize(const std::string& text)
       }
       case State::InOther:
       {
-         if (isLetter(curSymbol))
+         if (isLetter)
          {
             state = State::InWord;
             tokens.emplace_back(Token{ TokenType::Other, std::move(tokenText) });
@@ -153,9 +228,34 @@ TextSpellChecker::TokenVec TextSpellChecker::tokenize(const std::string& text)
    return tokens;
 }
 
-std::string TextSpellChecker::CheckText(const std::string& text) const
+void TextSpellChecker::OptimizeDictionaryLayout(std::string_view sampleText)
+{
+   WordSpellChecker::StringVec words;
+   for (const auto& [tokenType, tokenText] : tokenize(sampleText))
+   {
+      if (tokenType == TokenType::Word)
+      {
+         words.push_back(unicode::ToLower(tokenText));
+      }
+   }
+   m_wordChecker->OptimizeLayout(trie::StringViewVec(words.begin(), words.end()));
+}
+
+std::string TextSpellChecker::CheckText(std::string_view text) const
+{
+   size_t degradedWordCount = 0;
+   return CheckText(text, degradedWordCount);
+}
+
+std::string TextSpellChecker::CheckText(std::string_view text, size_t& degradedWordCount) const
 {
    std::string output;
+   const auto wordChecker = GetWordChecker();
+   WorkBudget textBudget(m_workLimits.maxTextMasks, m_workLimits.maxTextTime);
+
+   // masks of a word are allocated in the buffer and dropped at once, the next word reuses the buffer
+   const ScratchBuffer scratchBuffer(gc_scratchBufferSize, m_scratchResource);
+   std::pmr::monotonic_buffer_resource scratch(scratchBuffer.GetData(), scratchBuffer.GetSize(), m_scratchResource);
    const auto tokens = tokenize(text);
    for (const auto& [tokenType, tokenText]: tokens)
    {
@@ -163,13 +263,18 @@ std::string TextSpellChecker::CheckText(const std::string& text) const
       {
       case TokenType::Word:
       {
-         std::string lowerText = tokenText;
-         std::transform(lowerText.begin(), lowerText.end(), lowerText.begin(),
-            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+         const std::string lowerText = unicode::ToLower(tokenText);
+         WorkBudget wordBudget(m_workLimits.maxWordMasks, m_workLimits.maxWordTime, &textBudget);
 
-         const auto res = m_wordChecker.CheckSpelling(lowerText);
-         const auto toOutput = outputCorrection(tokenText, res);
-         output += toOutput;
+         if (m_maxCorrections != 0)
+         {
+            output += outputCorrection(tokenText, wordChecker->CheckSpelling(lowerText, m_maxCorrections, wordBudget, &scratch));
+         }
+         else
+         {
+            output += outputCorrection(tokenText, wordChecker->CheckSpelling(lowerText, wordBudget, &scratch));
+         }
+         scratch.release();
          break;
       }
         
@@ -182,5 +287,112 @@ std::string TextSpellChecker::CheckText(const std::string& text) const
          break;
       }
    }
+   degradedWordCount = textBudget.GetDegradedCount();
+   m_degradedWordCount.fetch_add(degradedWordCount, std::memory_order_relaxed);
    return output;
 }
+
+/// <summary>
+/// State of a <c>CheckTextAsync</c> call shared by its word checks
+/// </summary>
+struct TextSpellChecker::AsyncCheck
+{
+   AsyncCheck(const WorkLimits& limits, std::atomic<size_t>& degradedWordCount)
+      : budget(limits.maxTextMasks, limits.maxTextTime)
+      , totalDegradedWordCount(degradedWordCount)
+   {
+   }
+
+   TokenVec tokens;
+   /// <summary>
+   /// Output of every token, written once by its check
+   /// </summary>
+   std::vector<std::string> outputs;
+   std::atomic<size_t> pendingWords{ 0 };
+   /// <summary>
+   /// The dictionary the text is checked with, kept until all words are checked
+   /// </summary>
+   WordCheckerPtr wordChecker;
+   Executor executor;
+   TextCallback onChecked;
+   /// <summary>
+   /// Budget of the text, word budgets spend from it
+   /// </summary>
+   WorkBudget budget;
+   std::atomic<size_t>& totalDegradedWordCount;
+
+   void OnWordChecked()
+   {
+      if (pendingWords.fetch_sub(1, std::memory_order_acq_rel) != 1)
+      {
+         return;
+      }
+
+      std::string output;
+      for (const auto& tokenOutput : outputs)
+      {
+         output += tokenOutput;
+      }
+      totalDegradedWordCount.fetch_add(budget.GetDegradedCount(), std::memory_order_relaxed);
+      onChecked(std::move(output));
+   }
+};
+
+void TextSpellChecker::CheckTextAsync(std::string text, const Executor& executor, TextCallback onChecked) const
+{
+   // the dictionary is taken at the call, a later replacement doesn't affect the text
+   executor([this, text=std::move(text), wordChecker=GetWordChecker(), executor, onChecked=std::move(onChecked)]() mutable
+   {
+      auto check = std::make_shared<AsyncCheck>(m_workLimits, m_degradedWordCount);
+      check->tokens = tokenize(text);
+      check->outputs.resize(check->tokens.size());
+      check->wordChecker = std::move(wordChecker);
+      check->executor = std::move(executor);
+      check->onChecked = std::move(onChecked);
+
+      // one extra pending check keeps the text from completing until all words are posted
+      size_t wordCount = 1;
+      for (size_t i = 0; i < check->tokens.size(); ++i)
+      {
+         const auto& [tokenType, tokenText] = check->tokens[i];
+         if (tokenType == TokenType::Word)
+         {
+            ++wordCount;
+         }
+         else
+         {
+            check->outputs[i] = tokenText;
+         }
+      }
+      check->pendingWords.store(wordCount, std::memory_order_relaxed);
+
+      for (size_t i = 0; i < check->tokens.size(); ++i)
+      {
+         if (check->tokens[i].first == TokenType::Word)
+         {
+            checkWordAsync(check, i);
+         }
+      }
+      check->OnWordChecked();
+   });
+}
+
+void TextSpellChecker::checkWordAsync(const std::shared_ptr<AsyncCheck>& check, size_t tokenIndex) const
+{
+   const std::string& tokenText = check->tokens[tokenIndex].second;
+   const std::string lowerText = unicode::ToLower(tokenText);
+   const auto onWordChecked = [check, tokenIndex](auto res)
+   {
+      check->outputs[tokenIndex] = outputCorrection(check->tokens[tokenIndex].second, res);
+      check->OnWordChecked();
+   };
+
+   // the time of the word runs from the start of its check, not from posting
+   auto wordBudget = std::make_shared<WorkBudget>(m_workLimits.maxWordMasks, m_workLimits.maxWordTime, &check->budget);
+   if (m_maxCorrections != 0)
+   {
+      check->wordChecker->CheckSpellingAsync(lowerText, m_maxCorrections, check->executor, onWordChecked, std::move(wordBudget));
+      return;
+   }
+   check->wordChecker->CheckSpellingAsync(lowerText, check->executor, onWordChecked, std::move(wordBudget));
+}
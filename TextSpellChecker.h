@@ -2,15 +2,120 @@
 
 #include "WordSpellChecker.h"
 #include <string>
+#include <string_view>
+#include <functional>
+#include <memory>
 #include <utility>
+#include <atomic>
+#include <chrono>
+#include <memory_resource>
 
 class TextSpellChecker
 {
 public:
+   /// <summary>
+   /// Creates a checker with an empty dictionary
+   /// </summary>
+   /// <param name="dictionaryResource">memory of the dictionary, see <c>WordSpellChecker</c></param>
+   /// <param name="scratchResource">memory of the per-text scratch buffers <c>CheckText</c> allocates masks from</param>
+   explicit TextSpellChecker(std::pmr::memory_resource* dictionaryResource = std::pmr::get_default_resource(),
+      std::pmr::memory_resource* scratchResource = std::pmr::get_default_resource());
+
+   using WordCheckerPtr = std::shared_ptr<const WordSpellChecker>;
+
+   /// <summary>
+   /// Words are added to the current dictionary, must not run concurrently with checks or <c>ReplaceDictionary</c>
+   /// </summary>
    void AddWordToDictionary(const std::string& word);
    void AddWordToDictionary(std::initializer_list<std::string> list);
+   template<typename Itr>
+   void AddWordToDictionary(Itr first, Itr last);
+
+   /// <summary>
+   /// Replaces the dictionary atomically, may run concurrently with checks. Checks started before
+   /// finish with the old dictionary, it's freed when the last of them is done
+   /// </summary>
+   /// <param name="wordChecker">checker with the new dictionary</param>
+   /// <returns>The old dictionary, e.g. to track when it's freed</returns>
+   WordCheckerPtr ReplaceDictionary(std::shared_ptr<WordSpellChecker> wordChecker);
+
+   /// <summary>
+   /// The current dictionary, a check uses the one it started with
+   /// </summary>
+   WordCheckerPtr GetWordChecker() const;
+
+   /// <summary>
+   /// Limits the number of printed corrections for a word, the best ranked are kept
+   /// </summary>
+   /// <param name="maxCorrections">0 to print all corrections in the alphabetical order</param>
+   void SetMaxCorrections(size_t maxCorrections);
+
+   /// <summary>
+   /// Limits of the work a check does, zero for no limit. A word over its limits or the rest of the text limits
+   /// is degraded, see <c>WordSpellChecker::CheckSpelling(const std::string&, WorkBudget&)</c>
+   /// </summary>
+   struct WorkLimits
+   {
+      /// <summary>
+      /// Masks a word may match, the two correction masks of a word of n letters are ~3n^2
+      /// </summary>
+      size_t maxWordMasks = 0;
+      std::chrono::microseconds maxWordTime{ 0 };
+      size_t maxTextMasks = 0;
+      std::chrono::microseconds maxTextTime{ 0 };
+   };
+
+   /// <summary>
+   /// Must not run concurrently with checks
+   /// </summary>
+   void SetWorkLimits(const WorkLimits& limits);
+
+   /// <summary>
+   /// Lays the dictionary out for the words of a sample text, e.g. a typical document.
+   /// Must not run concurrently with checks
+   /// </summary>
+   void OptimizeDictionaryLayout(std::string_view sampleText);
+
+   /// <summary>
+   /// Runs blocking checks on the pool, must not run concurrently with checks
+   /// </summary>
+   /// <param name="workerPool">pool, see <c>WordSpellChecker::SetWorkerPool</c></param>
+   /// <param name="replicateDictionary">copy the dictionary to every NUMA node of the pool</param>
+   void SetWorkerPool(std::shared_ptr<WorkerPool> workerPool, bool replicateDictionary);
 
-   std::string CheckText(const std::string& text) const;
+   std::string CheckText(std::string_view text) const;
+
+   /// <summary>
+   /// Checks a text within the work limits
+   /// </summary>
+   /// <param name="text">text to check</param>
+   /// <param name="degradedWordCount">number of words checked with less work than needed</param>
+   /// <returns>The corrected text</returns>
+   std::string CheckText(std::string_view text, size_t& degradedWordCount) const;
+
+   /// <summary>
+   /// Number of degraded words of all checked texts
+   /// </summary>
+   size_t GetDegradedWordCount() const { return m_degradedWordCount.load(std::memory_order_relaxed); }
+
+   using Executor = WordSpellChecker::Executor;
+   using TextCallback = std::function<void(std::string)>;
+
+   /// <summary>
+   /// Non-blocking <c>CheckText</c>: the text is tokenized and its words are checked in tasks posted to the executor,
+   /// so many texts interleave on the executor threads. The checker must outlive the call
+   /// </summary>
+   /// <param name="text">text to check</param>
+   /// <param name="executor">runs the tasks</param>
+   /// <param name="onChecked">called on an executor thread with the corrected text</param>
+   void CheckTextAsync(std::string text, const Executor& executor, TextCallback onChecked) const;
+
+   using DictionaryPtr = std::shared_ptr<const trie::Trie>;
+
+   /// <summary>
+   /// The current dictionary, kept alive with its word checker when the dictionary is replaced
+   /// </summary>
+   DictionaryPtr GetDictionary() const;
 private:
 
    enum class TokenType
@@ -22,17 +127,77 @@ private:
    using Token = std::pair<TokenType, std::string>;
    using TokenVec = std::vector<Token>;
 
-   static TokenVec tokenize(const std::string& text);
+   static TokenVec tokenize(std::string_view text);
 
-   WordSpellChecker m_wordChecker;
+   struct AsyncCheck;
+
+   void checkWordAsync(const std::shared_ptr<AsyncCheck>& check, size_t tokenIndex) const;
+
+   /// <summary>
+   /// Accessed with atomic_load/atomic_exchange to be replaced while checks run
+   /// </summary>
+   std::shared_ptr<WordSpellChecker> m_wordChecker;
+   size_t m_maxCorrections;
+   WorkLimits m_workLimits;
+   mutable std::atomic<size_t> m_degradedWordCount;
+   std::pmr::memory_resource* m_scratchResource;
 };
 
+inline TextSpellChecker::TextSpellChecker(std::pmr::memory_resource* dictionaryResource, std::pmr::memory_resource* scratchResource)
+   : m_wordChecker(std::make_shared<WordSpellChecker>(dictionaryResource))
+   , m_maxCorrections(0)
+   , m_degradedWordCount(0)
+   , m_scratchResource(scratchResource)
+{
+}
+
 inline void TextSpellChecker::AddWordToDictionary(const std::string& word)
 {
-   m_wordChecker.AddWord(word);
+   m_wordChecker->AddWord(word);
 }
 
 inline void TextSpellChecker::AddWordToDictionary(std::initializer_list<std::string> list)
 {
-   m_wordChecker.AddWords(std::move(list));
+   m_wordChecker->AddWords(std::move(list));
+}
+
+template<typename Itr>
+inline void TextSpellChecker::AddWordToDictionary(Itr first, Itr last)
+{
+   m_wordChecker->AddWords(first, last);
+}
+
+inline void TextSpellChecker::SetWorkerPool(std::shared_ptr<WorkerPool> workerPool, bool replicateDictionary)
+{
+   m_wordChecker->SetWorkerPool(std::move(workerPool));
+   if (replicateDictionary)
+   {
+      m_wordChecker->ReplicateDictionary();
+   }
+}
+
+inline TextSpellChecker::WordCheckerPtr TextSpellChecker::ReplaceDictionary(std::shared_ptr<WordSpellChecker> wordChecker)
+{
+   return std::atomic_exchange(&m_wordChecker, std::move(wordChecker));
+}
+
+inline TextSpellChecker::WordCheckerPtr TextSpellChecker::GetWordChecker() const
+{
+   return std::atomic_load(&m_wordChecker);
+}
+
+inline TextSpellChecker::DictionaryPtr TextSpellChecker::GetDictionary() const
+{
+   const auto wordChecker = GetWordChecker();
+   return DictionaryPtr(wordChecker, &wordChecker->GetDictionary());
+}
+
+inline void TextSpellChecker::SetMaxCorrections(size_t maxCorrections)
+{
+   m_maxCorrections = maxCorrections;
+}
+
+inline void TextSpellChecker::SetWorkLimits(const WorkLimits& limits)
+{
+   m_workLimits = limits;
 }
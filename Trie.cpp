@@ -1,122 +1,1164 @@
 #include "Trie.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <future>
+#include <thread>
 
 namespace trie
 {
 
-Trie::Trie()
-   : m_root(sc_rootLetter)
+namespace
 {
+
+using RankedWordView = internal::TrieNodePool::RankedWordView;
+using RankedWordViewVec = internal::TrieNodePool::RankedWordViewVec;
+using RankedWordViewVecConstIt = internal::TrieNodePool::RankedWordViewVecConstIt;
+
+/// <summary>
+/// Range of sorted words sharing a prefix and the node the prefix ends with
+/// </summary>
+struct Shard
+{
+   internal::NodeIndex node;
+   RankedWordViewVecConstIt first;
+   RankedWordViewVecConstIt last;
+   size_t prefixSize;
+
+   /// <summary>
+   /// Nodes built for the shard, the root stands for the prefix node
+   /// </summary>
+   internal::TrieNodePool nodes;
+};
+
+size_t getThreadNumber()
+{
+   return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+/// <summary>
+/// Byte length of the first letters of a word
+/// </summary>
+/// <returns>Byte length of the prefix, the word size if it is shorter</returns>
+size_t getPrefixSize(std::string_view word, size_t letterNumber)
+{
+   size_t pos = 0;
+   for (size_t i = 0; i < letterNumber && pos < word.size(); ++i)
+   {
+      unicode::Decode(word, pos);
+   }
+   return pos;
+}
+
+size_t countFirstLetters(const RankedWordViewVec& sortedWords)
+{
+   size_t count = 0;
+   std::string_view previousLetter;
+   for (const auto& [rank, word] : sortedWords)
+   {
+      const auto letter = word.substr(0, getPrefixSize(word, 1));
+      if (!letter.empty() && letter != previousLetter)
+      {
+         ++count;
+      }
+      previousLetter = letter;
+   }
+   return count;
+}
+
+/// <summary>
+/// Finds the end of the group of words sharing the first <c>prefixSize</c> bytes with the first word
+/// </summary>
+RankedWordViewVecConstIt findPrefixGroupEnd(RankedWordViewVecConstIt first, RankedWordViewVecConstIt last, size_t prefixSize)
+{
+   return std::find_if(first, last, [prefix = first->second, prefixSize](const RankedWordView& word)
+   {
+      return word.second.compare(0, prefixSize, prefix, 0, prefixSize) != 0;
+   });
+}
+
+Rank getBestRank(RankedWordViewVecConstIt first, RankedWordViewVecConstIt last)
+{
+   return std::min_element(first, last)->first;
+}
+
+/// <summary>
+/// Reads the mask letter at the position, ASCII fast path
+/// </summary>
+char32_t readMaskLetter(std::string_view mask, size_t& pos)
+{
+   if (unicode::IsAscii(mask[pos]))
+   {
+      return static_cast<unsigned char>(mask[pos++]);
+   }
+   return unicode::Decode(mask, pos);
+}
+
+/// <summary>
+/// Number of letters of a mask or a word
+/// </summary>
+size_t countLetters(std::string_view text)
+{
+   size_t letterCount = 0;
+   for (size_t pos = 0; pos < text.size(); ++letterCount)
+   {
+      readMaskLetter(text, pos);
+   }
+   return letterCount;
+}
+
+/// <summary>
+/// No mask index
+/// </summary>
+constexpr uint32_t gc_noMask = std::numeric_limits<uint32_t>::max();
+
+template<typename Visitor>
+void appendLetter(std::string& matchedSoFar, char32_t letter)
+{
+   if constexpr (Visitor::sc_isWordNeeded)
+   {
+      if (letter < 0x80)
+      {
+         matchedSoFar.push_back(static_cast<char>(letter));
+      }
+      else
+      {
+         unicode::Append(matchedSoFar, letter);
+      }
+   }
+}
+
+template<typename Visitor>
+void removeLetter(std::string& matchedSoFar, char32_t letter)
+{
+   if constexpr (Visitor::sc_isWordNeeded)
+   {
+      matchedSoFar.resize(matchedSoFar.size() - unicode::EncodedLength(letter));
+   }
+}
+
+bool isInAlphabet(const unicode::Alphabet& alphabet, char32_t letter)
+{
+   return std::any_of(alphabet.cbegin(), alphabet.cend(), [letter](const unicode::CodePointRange& range)
+   {
+      return range.first <= letter && letter <= range.last;
+   });
+}
+
+/// <summary>
+/// Reports every word found by a multi-mask search
+/// </summary>
+class AllWordsVisitor
+{
+public:
+   static constexpr bool sc_isWordNeeded = true;
+
+   AllWordsVisitor(const internal::TrieNodePool::FnFound& onFound, SearchStats* stats)
+      : m_onFound(onFound)
+      , m_stats(stats)
+   {
+   }
+
+   bool Enter(const internal::TrieNode&)
+   {
+      if (m_stats)
+      {
+         ++m_stats->visitedNodes;
+      }
+      return true;
+   }
+
+   void Found(internal::NodeIndex, const internal::TrieNode&, const std::string& word, uint32_t) { m_onFound(word); }
+
+private:
+   const internal::TrieNodePool::FnFound& m_onFound;
+   SearchStats* m_stats;
+};
+
+/// <summary>
+/// Collects the words found by a multi-mask search with the masks they matched, the words are not spelled out
+/// </summary>
+class WordMatchesVisitor
+{
+public:
+   static constexpr bool sc_isWordNeeded = false;
+
+   WordMatchesVisitor(WordMatchVec& matches, SearchStats* stats)
+      : m_matches(matches)
+      , m_stats(stats)
+   {
+   }
+
+   bool Enter(const internal::TrieNode&)
+   {
+      if (m_stats)
+      {
+         ++m_stats->visitedNodes;
+      }
+      return true;
+   }
+
+   void Found(internal::NodeIndex node, const internal::TrieNode& trieNode, const std::string&, uint32_t mask)
+   {
+      m_matches.push_back({ node, mask, trieNode.GetRank() });
+   }
+
+private:
+   WordMatchVec& m_matches;
+   SearchStats* m_stats;
+};
+
+/// <summary>
+/// Collects the best ranked words found by a multi-mask search, skips subtrees without better words
+/// </summary>
+class BestWordsVisitor
+{
+public:
+   static constexpr bool sc_isWordNeeded = true;
+
+   explicit BestWordsVisitor(BestWords& best)
+      : m_best(best)
+   {
+   }
+
+   bool Enter(const internal::TrieNode& trieNode) const { return m_best.IsAccepted(trieNode.GetBestRank()); }
+
+   void Found(internal::NodeIndex, const internal::TrieNode& trieNode, const std::string& word, uint32_t)
+   {
+      m_best.Add(trieNode.GetRank(), word);
+   }
+
+private:
+   BestWords& m_best;
+};
+
+}
+
+void BestWords::Add(Rank rank, const std::string& word)
+{
+   if (!IsAccepted(rank))
+   {
+      return;
+   }
+   const auto itSame = std::find_if(m_words.cbegin(), m_words.cend(), [&word](const RankedWord& heldWord)
+   {
+      return heldWord.second == word;
+   });
+   if (itSame != m_words.cend())
+   {
+      return;
+   }
+
+   if (m_words.size() == m_maxSize)
+   {
+      std::pop_heap(m_words.begin(), m_words.end());
+      m_words.pop_back();
+   }
+   m_words.emplace_back(rank, word);
+   std::push_heap(m_words.begin(), m_words.end());
+}
+
+RankedWordVec BestWords::Take()
+{
+   std::sort_heap(m_words.begin(), m_words.end());
+   return std::move(m_words);
+}
+
+Trie::Trie(std::pmr::memory_resource* resource)
+   : m_nodes(resource)
+   , m_nextRank(0)
+{
+}
+
+Trie Trie::Clone() const
+{
+   Trie copy(GetMemoryResource());
+   copy.m_nodes = m_nodes.Clone();
+   copy.m_nextRank = m_nextRank;
+   return copy;
+}
+
+bool Trie::isValidWord(std::string_view word)
+{
+   for (size_t pos = 0; pos < word.size();)
+   {
+      if (unicode::IsAsciiLetter(word[pos]))
+      {
+         ++pos; // ASCII fast path
+      }
+      else if (!unicode::IsLetter(unicode::Decode(word, pos)))
+      {
+         return false;
+      }
+   }
+   return true;
 }
 
 void Trie::Add(const std::string& word)
 {
-   m_root.AddSuffix(word);
+   Add(word, m_nextRank);
 }
 
-Trie::StringVec Trie::FindAll(const std::string& mask) const
+void Trie::Add(const std::string& word, Rank rank)
+{
+   m_nextRank = std::max(m_nextRank, rank + 1);
+   if (isValidWord(word))
+   {
+      m_nodes.AddSuffix(internal::TrieNodePool::sc_root, word, rank);
+   }
+}
+
+bool Trie::Contains(std::string_view word) const
+{
+   WordId wordId = 0;
+   return Find(word, wordId);
+}
+
+bool Trie::Find(std::string_view word, WordId& wordId) const
+{
+   auto node = internal::TrieNodePool::sc_root;
+   for (size_t pos = 0; pos < word.size();)
+   {
+      node = m_nodes.FindChild(node, readMaskLetter(word, pos));
+      if (node == internal::TrieNodePool::sc_root)
+      {
+         return false;
+      }
+   }
+   if (!m_nodes[node].CanBeTerminal())
+   {
+      return false;
+   }
+   wordId = node;
+   return true;
+}
+
+void Trie::OptimizeLayout(const StringViewVec& sampleWords)
+{
+   std::vector<uint32_t> visits(m_nodes.GetNodeCount(), 0);
+   for (const auto word : sampleWords)
+   {
+      auto node = internal::TrieNodePool::sc_root;
+      ++visits[node];
+      for (size_t pos = 0; pos < word.size();)
+      {
+         node = m_nodes.FindChild(node, readMaskLetter(word, pos));
+         if (node == internal::TrieNodePool::sc_root)
+         {
+            break;
+         }
+         ++visits[node];
+      }
+   }
+   m_nodes.Relayout(visits);
+}
+
+Trie::StringVec Trie::FindAll(const std::string& mask, unicode::Script script, SearchStats* stats) const
+{
+   return FindAll(StringViewVec{ mask }, script, stats);
+}
+
+Trie::StringVec Trie::FindAll(const StringViewVec& masks, unicode::Script script, SearchStats* stats) const
 {
    StringVec result;
-   m_root.FindAll({}, mask,
-      [&result](const std::string& foundWord)
+   m_nodes.FindAll(masks, unicode::GetAlphabet(script), [&result](const std::string& foundWord)
    {
       result.push_back(foundWord);
+   }, stats);
+   return result;
+}
+
+WordMatchVec Trie::FindAllMatches(const StringViewVec& masks, unicode::Script script, SearchStats* stats) const
+{
+   WordMatchVec result;
+   m_nodes.FindAll(masks, unicode::GetAlphabet(script), result, stats);
+   std::sort(result.begin(), result.end(), [](const WordMatch& left, const WordMatch& right)
+   {
+      return left.word < right.word;
    });
    return result;
 }
 
-namespace internal
+void Trie::FindBest(const std::string& mask, BestWords& best, unicode::Script script) const
 {
+   FindBest(StringViewVec{ mask }, best, script);
+}
 
-bool operator < (char left, const TrieNode& right)
+void Trie::FindBest(const StringViewVec& masks, BestWords& best, unicode::Script script) const
 {
-   return left < right.GetLetter();
+   m_nodes.FindBest(masks, unicode::GetAlphabet(script), best);
 }
 
-bool operator < (const TrieNode& left, char right)
+size_t Trie::MemoryUsage() const
 {
-   return left.GetLetter() < right;
+   return sizeof(*this) + m_nodes.MemoryUsage();
 }
 
-void TrieNode::AddSuffix(const std::string& suffix)
+void Trie::AddAll(const StringVec& words)
 {
-   if (suffix.empty())
+   AddAll(StringViewVec(words.cbegin(), words.cend()));
+}
+
+void Trie::AddAll(const StringViewVec& words)
+{
+   using internal::NodeIndex;
+   using internal::TrieNodePool;
+
+   if (words.size() < sc_minSortedBuildWords)
    {
-      m_canBeTerminal = true;
+      for (const auto word : words)
+      {
+         Add(std::string(word));
+      }
       return;
    }
 
-   const auto prefix = suffix[0];
-   const auto newSuffix = suffix.substr(1);
-   auto [found, itEqualOrGreater] = findChildOrWhereToInsert(prefix);
-   if (found)
+   RankedWordViewVec rankedWords;
+   rankedWords.reserve(words.size());
+   for (const auto& word : words)
    {
-      itEqualOrGreater->AddSuffix(newSuffix);
+      const auto rank = m_nextRank++;
+      if (isValidWord(word))
+      {
+         rankedWords.emplace_back(rank, word);
+      }
+   }
+
+   std::sort(rankedWords.begin(), rankedWords.end(), [](const RankedWordView& left, const RankedWordView& right)
+   {
+      return left.second < right.second || (left.second == right.second && left.first < right.first);
+   });
+   rankedWords.erase(std::unique(rankedWords.begin(), rankedWords.end(), [](const RankedWordView& left, const RankedWordView& right)
+   {
+      return left.second == right.second;
+   }), rankedWords.end());
+
+   const size_t threadNumber = getThreadNumber();
+   const size_t prefixLength = countFirstLetters(rankedWords) < threadNumber ? 2 : 1;
+
+   const auto getOrAddPrefixNode = [this, prefixLength](std::string_view word, Rank bestRank)
+   {
+      NodeIndex node = TrieNodePool::sc_root;
+      m_nodes[node].LowerBestRank(bestRank);
+      for (size_t pos = 0, depth = 0; depth < prefixLength; ++depth)
+      {
+         node = m_nodes.GetOrAddChild(node, unicode::Decode(word, pos));
+         m_nodes[node].LowerBestRank(bestRank);
+      }
+      return node;
+   };
+   // the words of a prefix node are noted in the nodes above it when the node is built
+   const auto addPrefixWords = [this](std::string_view prefix)
+   {
+      std::vector<NodeIndex> path{ TrieNodePool::sc_root };
+      for (size_t pos = 0; pos < prefix.size();)
+      {
+         path.push_back(m_nodes.FindChild(path.back(), unicode::Decode(prefix, pos)));
+      }
+      for (size_t i = path.size() - 1; i > 0; --i)
+      {
+         m_nodes[path[i - 1]].AddChildWords(m_nodes[path[i]]);
+      }
+   };
+
+   // Words up to the prefix length are added serially, the prefix nodes of the shards are created.
+   // Shards under prefix nodes without children are built in own pools in parallel and attached afterwards,
+   // the others are merged into existing nodes serially.
+   std::vector<Shard> shards;
+   for (auto first = rankedWords.cbegin(); first != rankedWords.cend();)
+   {
+      const auto prefixSize = getPrefixSize(first->second, prefixLength);
+      if (first->second.size() <= prefixSize)
+      {
+         m_nodes.AddSuffix(TrieNodePool::sc_root, first->second, first->first);
+         ++first;
+         continue;
+      }
+      const auto last = findPrefixGroupEnd(first, rankedWords.cend(), prefixSize);
+      const auto node = getOrAddPrefixNode(first->second, getBestRank(first, last));
+      if (m_nodes.GetChildCount(node) == 0)
+      {
+         shards.push_back({ node, first, last, prefixSize, TrieNodePool(m_nodes.GetMemoryResource()) });
+      }
+      else
+      {
+         m_nodes.AddSortedSuffixes(node, first, last, prefixSize);
+         addPrefixWords(first->second.substr(0, prefixSize));
+      }
+      first = last;
+   }
+
+   std::atomic<size_t> nextShard = 0;
+   const auto buildShards = [&shards, &nextShard]()
+   {
+      for (size_t i = nextShard++; i < shards.size(); i = nextShard++)
+      {
+         shards[i].nodes.AddSortedSuffixes(TrieNodePool::sc_root, shards[i].first, shards[i].last, shards[i].prefixSize);
+      }
+   };
+
+   std::vector<std::future<void>> tasks;
+   for (size_t i = 1; i < std::min(threadNumber, shards.size()); ++i)
+   {
+      tasks.emplace_back(std::async(std::launch::async, buildShards));
+   }
+   buildShards();
+   for (auto& task : tasks)
+   {
+      task.get();
+   }
+
+   for (auto& shard : shards)
+   {
+      m_nodes.Attach(shard.node, std::move(shard.nodes));
+      addPrefixWords(shard.first->second.substr(0, shard.prefixSize));
+   }
+}
+
+namespace internal
+{
+
+bool TrieNode::SetTerminal(Rank rank)
+{
+   const bool isNew = !m_canBeTerminal;
+   m_canBeTerminal = true;
+   m_rank = std::min(m_rank, rank);
+   LowerBestRank(rank);
+   AddWordAt(0);
+   return isNew;
+}
+
+TrieNodePool::TrieNodePool(std::pmr::memory_resource* resource)
+   : m_nodes(resource)
+   , m_parents(resource)
+   , m_spilledChildren(resource)
+   , m_wordCount(0)
+{
+   m_nodes.emplace_back(TrieNode::sc_rootLetter);
+   m_parents.push_back(sc_root);
+}
+
+TrieNodePool TrieNodePool::Clone() const
+{
+   TrieNodePool copy(GetMemoryResource());
+   copy.m_nodes = m_nodes;
+   copy.m_parents = m_parents;
+   copy.m_spilledChildren = m_spilledChildren;
+   copy.m_wordCount = m_wordCount;
+   return copy;
+}
+
+size_t TrieNodePool::GetChildCount(NodeIndex node) const
+{
+   const auto& trieNode = m_nodes[node];
+   return trieNode.IsSpilled() ? m_spilledChildren[trieNode.m_spilledChildren].size() : trieNode.m_inlineChildCount;
+}
+
+std::string TrieNodePool::GetWord(NodeIndex node) const
+{
+   std::u32string letters;
+   for (; node != sc_root; node = m_parents[node])
+   {
+      letters.push_back(m_nodes[node].GetLetter());
+   }
+   std::string word;
+   word.reserve(letters.size());
+   std::for_each(letters.crbegin(), letters.crend(), [&word](char32_t letter)
+   {
+      unicode::Append(word, letter);
+   });
+   return word;
+}
+
+NodeIndex TrieNodePool::FindChild(NodeIndex node, char32_t letter) const
+{
+   const auto& trieNode = m_nodes[node];
+   if (!trieNode.IsSpilled())
+   {
+      // the letters are read from the children: two more code points would grow the node to 32 bytes,
+      // which slows the mask walks down more than it speeds the exact lookups up
+      for (size_t i = 0; i < trieNode.m_inlineChildCount; ++i)
+      {
+         const auto child = trieNode.m_inlineChildren[i];
+         if (m_nodes[child].GetLetter() == letter)
+         {
+            return child;
+         }
+      }
+      return sc_root;
+   }
+
+   const auto& children = m_spilledChildren[trieNode.m_spilledChildren];
+   if (children.size() <= sc_linearSearchMax)
+   {
+      for (const auto& spilledChild : children)
+      {
+         if (letter <= spilledChild.letter)
+         {
+            return letter == spilledChild.letter ? spilledChild.child : sc_root;
+         }
+      }
+      return sc_root;
+   }
+
+   const auto itEqualOrGreater = std::lower_bound(children.cbegin(), children.cend(), letter,
+      [](const SpilledChild& spilledChild, char32_t letter)
+   {
+      return spilledChild.letter < letter;
+   });
+   if (itEqualOrGreater != children.cend() && itEqualOrGreater->letter == letter)
+   {
+      return itEqualOrGreater->child;
+   }
+   return sc_root;
+}
+
+NodeIndex TrieNodePool::GetOrAddChild(NodeIndex node, char32_t letter)
+{
+   const auto& trieNode = m_nodes[node];
+   size_t where = 0;
+   if (!trieNode.IsSpilled())
+   {
+      for (; where < trieNode.m_inlineChildCount; ++where)
+      {
+         const auto child = trieNode.m_inlineChildren[where];
+         const auto childLetter = m_nodes[child].GetLetter();
+         if (childLetter == letter)
+         {
+            return child;
+         }
+         if (letter < childLetter)
+         {
+            break;
+         }
+      }
+   }
+   else
+   {
+      const auto& children = m_spilledChildren[trieNode.m_spilledChildren];
+      where = children.size();
+      if (children.back().letter >= letter) // sorted input is appended
+      {
+         const auto itEqualOrGreater = std::lower_bound(children.cbegin(), children.cend(), letter,
+            [](const SpilledChild& spilledChild, char32_t letter)
+         {
+            return spilledChild.letter < letter;
+         });
+         if (itEqualOrGreater->letter == letter)
+         {
+            return itEqualOrGreater->child;
+         }
+         where = static_cast<size_t>(itEqualOrGreater - children.cbegin());
+      }
+   }
+
+   const auto child = addNode(node, letter);
+   insertChild(node, where, child);
+   return child;
+}
+
+NodeIndex TrieNodePool::addNode(NodeIndex parent, char32_t letter)
+{
+   m_nodes.emplace_back(letter);
+   m_parents.push_back(parent);
+   return static_cast<NodeIndex>(m_nodes.size() - 1);
+}
+
+void TrieNodePool::insertChild(NodeIndex node, size_t where, NodeIndex child)
+{
+   auto& trieNode = m_nodes[node];
+   const size_t childCount = trieNode.m_inlineChildCount;
+   const SpilledChild spilledChild{ m_nodes[child].GetLetter(), child };
+   if (trieNode.IsSpilled())
+   {
+      auto& children = m_spilledChildren[trieNode.m_spilledChildren];
+      children.insert(children.begin() + where, spilledChild);
+   }
+   else if (childCount < TrieNode::sc_inlineChildren)
+   {
+      auto* children = trieNode.m_inlineChildren;
+      std::copy_backward(children + where, children + childCount, children + childCount + 1);
+      children[where] = child;
+      ++trieNode.m_inlineChildCount;
    }
    else
    {
-      TrieNode newNode(prefix);
-      newNode.AddSuffix(newSuffix);
-      m_children.emplace(itEqualOrGreater, std::move(newNode));
+      SpilledChildVec children(GetMemoryResource());
+      for (size_t i = 0; i < childCount; ++i)
+      {
+         const auto inlineChild = trieNode.m_inlineChildren[i];
+         children.push_back({ m_nodes[inlineChild].GetLetter(), inlineChild });
+      }
+      children.insert(children.begin() + where, spilledChild);
+      trieNode.m_isSpilled = true;
+      trieNode.m_inlineChildCount = 0;
+      trieNode.m_spilledChildren = static_cast<uint32_t>(m_spilledChildren.size());
+      m_spilledChildren.emplace_back(std::move(children));
    }
 }
 
-TrieNode::TrieNodeVec::const_iterator TrieNode::findChild(char letter) const
+void TrieNodePool::AddSuffix(NodeIndex node, std::string_view suffix, Rank rank)
 {
-   const auto itEqualOrGreater = std::lower_bound(m_children.cbegin(), m_children.cend(), letter);
-   if (itEqualOrGreater != m_children.end() &&
-      itEqualOrGreater->GetLetter() == letter)
+   size_t distance = countLetters(suffix);
+   m_nodes[node].LowerBestRank(rank);
+   m_nodes[node].AddWordAt(distance);
+   for (size_t pos = 0; pos < suffix.size();)
+   {
+      node = GetOrAddChild(node, unicode::Decode(suffix, pos));
+      m_nodes[node].LowerBestRank(rank);
+      m_nodes[node].AddWordAt(--distance);
+   }
+   if (m_nodes[node].SetTerminal(rank))
    {
-      return itEqualOrGreater;
+      ++m_wordCount;
    }
-   return m_children.cend();
 }
 
-TrieNode::FoundAndWhere TrieNode::findChildOrWhereToInsert(char letter)
+void TrieNodePool::AddSortedSuffixes(NodeIndex node, RankedWordViewVecConstIt first, RankedWordViewVecConstIt last, size_t depth)
 {
-   const auto itEqualOrGreater = std::lower_bound(m_children.begin(), m_children.end(), letter);
-   if (itEqualOrGreater != m_children.end() &&
-      itEqualOrGreater->GetLetter() == letter)
+   for (; first != last && first->second.size() == depth; ++first)
    {
-      return std::make_pair(true, itEqualOrGreater);
+      if (m_nodes[node].SetTerminal(first->first))
+      {
+         ++m_wordCount;
+      }
+   }
+
+   while (first != last)
+   {
+      // UTF-8 keeps the code point order, so words with the same next letter are adjacent
+      size_t nextDepth = depth;
+      const auto letter = unicode::Decode(first->second, nextDepth);
+      const auto letterSize = nextDepth - depth;
+      const auto groupEnd = std::find_if(first, last, [word = first->second, depth, letterSize](const RankedWordView& other)
+      {
+         return other.second.compare(depth, letterSize, word, depth, letterSize) != 0;
+      });
+      const auto child = GetOrAddChild(node, letter);
+      AddSortedSuffixes(child, first, groupEnd, nextDepth);
+      m_nodes[node].LowerBestRank(m_nodes[child].GetBestRank());
+      m_nodes[node].AddChildWords(m_nodes[child]);
+      first = groupEnd;
    }
-   return std::make_pair(false, itEqualOrGreater);
 }
 
-void TrieNode::FindAll(const std::string& matchedSoFar, const std::string& mask, const FnFound& onFound) const
+void TrieNodePool::Attach(NodeIndex node, TrieNodePool&& other)
 {
-   if (mask.empty())
+   // other's root becomes the node, the rest of other's nodes are appended after ours
+   const auto nodeOffset = static_cast<NodeIndex>(m_nodes.size() - 1);
+   const auto spilledOffset = static_cast<uint32_t>(m_spilledChildren.size());
+   const auto rebase = [nodeOffset](NodeIndex child)
+   {
+      return child + nodeOffset;
+   };
+   const auto rebaseChildren = [&rebase, spilledOffset](TrieNode& trieNode)
+   {
+      if (trieNode.IsSpilled())
+      {
+         trieNode.m_spilledChildren += spilledOffset;
+      }
+      else
+      {
+         std::transform(trieNode.m_inlineChildren, trieNode.m_inlineChildren + trieNode.m_inlineChildCount,
+            trieNode.m_inlineChildren, rebase);
+      }
+   };
+
+   for (auto& children : other.m_spilledChildren)
    {
-      if (m_canBeTerminal)
+      for (auto& spilledChild : children)
       {
-         onFound(matchedSoFar);
+         spilledChild.child = rebase(spilledChild.child);
+      }
+   }
+   m_spilledChildren.reserve(m_spilledChildren.size() + other.m_spilledChildren.size());
+   std::move(other.m_spilledChildren.begin(), other.m_spilledChildren.end(), std::back_inserter(m_spilledChildren));
+
+   m_nodes.reserve(m_nodes.size() + other.m_nodes.size() - 1);
+   for (auto it = other.m_nodes.begin() + 1; it != other.m_nodes.end(); ++it)
+   {
+      rebaseChildren(*it);
+      m_nodes.push_back(*it);
+   }
+   m_parents.reserve(m_nodes.size());
+   for (auto it = other.m_parents.begin() + 1; it != other.m_parents.end(); ++it)
+   {
+      m_parents.push_back(*it == sc_root ? node : rebase(*it));
+   }
+
+   auto& otherRoot = other.m_nodes[sc_root];
+   rebaseChildren(otherRoot);
+   auto& trieNode = m_nodes[node];
+   trieNode.m_isSpilled = otherRoot.m_isSpilled;
+   trieNode.m_inlineChildCount = otherRoot.m_inlineChildCount;
+   std::copy(otherRoot.m_inlineChildren, otherRoot.m_inlineChildren + TrieNode::sc_inlineChildren, trieNode.m_inlineChildren);
+   if (otherRoot.CanBeTerminal() && trieNode.SetTerminal(otherRoot.GetRank()))
+   {
+      ++m_wordCount;
+   }
+   trieNode.LowerBestRank(otherRoot.GetBestRank());
+   trieNode.m_wordLengths |= otherRoot.m_wordLengths;
+   m_wordCount += other.m_wordCount - (otherRoot.CanBeTerminal() ? 1 : 0);
+}
+
+template<typename Fn>
+void TrieNodePool::forEachChild(NodeIndex node, Fn fn) const
+{
+   const auto& trieNode = m_nodes[node];
+   if (trieNode.IsSpilled())
+   {
+      for (const auto& spilledChild : m_spilledChildren[trieNode.m_spilledChildren])
+      {
+         fn(spilledChild.child);
+      }
+      return;
+   }
+   std::for_each(trieNode.m_inlineChildren, trieNode.m_inlineChildren + trieNode.m_inlineChildCount, fn);
+}
+
+template<typename Fn>
+void TrieNodePool::forEachChild(NodeIndex node, const unicode::Alphabet& alphabet, Fn fn) const
+{
+   const auto& trieNode = m_nodes[node];
+   if (!trieNode.IsSpilled())
+   {
+      for (size_t i = 0; i < trieNode.m_inlineChildCount; ++i)
+      {
+         const auto child = trieNode.m_inlineChildren[i];
+         if (isInAlphabet(alphabet, m_nodes[child].GetLetter()))
+         {
+            fn(child);
+         }
       }
       return;
    }
 
-   const auto letter = mask[0];
-   const auto rest = mask.substr(1);
+   // Children are sorted by code point, so every alphabet range is a contiguous run of them
+   const auto& children = m_spilledChildren[trieNode.m_spilledChildren];
+   const auto lowest = children.front().letter;
+   const auto highest = children.back().letter;
+   for (const auto& range : alphabet)
+   {
+      if (range.last < lowest)
+      {
+         continue;
+      }
+      if (highest < range.first)
+      {
+         break;
+      }
+      auto it = range.first <= lowest ? children.cbegin() :
+         std::lower_bound(children.cbegin(), children.cend(), range.first, [](const SpilledChild& spilledChild, char32_t letter)
+      {
+         return spilledChild.letter < letter;
+      });
+      for (; it != children.cend() && it->letter <= range.last; ++it)
+      {
+         fn(it->child);
+      }
+   }
+}
+
+void TrieNodePool::FindAll(const StringViewVec& masks, const unicode::Alphabet& alphabet, const FnFound& onFound,
+   SearchStats* stats) const
+{
+   auto positions = getStartPositions(masks);
+   std::string matchedSoFar;
+   AllWordsVisitor visitor(onFound, stats);
+   findMasks(sc_root, masks, positions, 0, positions.size(), alphabet, matchedSoFar, visitor);
+}
+
+void TrieNodePool::FindAll(const StringViewVec& masks, const unicode::Alphabet& alphabet, WordMatchVec& matches,
+   SearchStats* stats) const
+{
+   auto positions = getStartPositions(masks);
+   std::string matchedSoFar;
+   WordMatchesVisitor visitor(matches, stats);
+   findMasks(sc_root, masks, positions, 0, positions.size(), alphabet, matchedSoFar, visitor);
+}
+
+void TrieNodePool::FindBest(const StringViewVec& masks, const unicode::Alphabet& alphabet, BestWords& best) const
+{
+   auto positions = getStartPositions(masks);
+   std::string matchedSoFar;
+   BestWordsVisitor visitor(best);
+   findMasks(sc_root, masks, positions, 0, positions.size(), alphabet, matchedSoFar, visitor);
+}
 
-   if (letter == sc_anyLetter)
+TrieNodePool::MaskPositionVec TrieNodePool::getStartPositions(const StringViewVec& masks)
+{
+   MaskPositionVec positions;
+   positions.reserve(masks.size());
+   for (uint32_t i = 0; i < masks.size(); ++i)
    {
-      for (const auto& child: m_children)
+      positions.push_back({ i, 0, 0, static_cast<uint32_t>(countLetters(masks[i])) });
+   }
+   return positions;
+}
+
+template<typename Visitor>
+void TrieNodePool::findMask(NodeIndex node, std::string_view mask, uint32_t maskIndex, size_t pos, size_t letterCount,
+   const unicode::Alphabet& alphabet, std::string& matchedSoFar, Visitor& visitor) const
+{
+   const auto& trieNode = m_nodes[node];
+   if (!trieNode.HasWordAt(letterCount) || !visitor.Enter(trieNode))
+   {
+      return;
+   }
+
+   if (pos == mask.size())
+   {
+      if (trieNode.CanBeTerminal())
       {
-         const auto newMatchedSoFar = matchedSoFar + child.GetLetter();
-         child.FindAll(newMatchedSoFar, rest, onFound);
+         visitor.Found(node, trieNode, matchedSoFar, maskIndex);
       }
+      return;
+   }
+
+   const auto letter = readMaskLetter(mask, pos);
+   if (letter == static_cast<char32_t>(sc_anyLetter))
+   {
+      forEachChild(node, alphabet, [&](NodeIndex child)
+      {
+         const auto childLetter = m_nodes[child].GetLetter();
+         appendLetter<Visitor>(matchedSoFar, childLetter);
+         findMask(child, mask, maskIndex, pos, letterCount - 1, alphabet, matchedSoFar, visitor);
+         removeLetter<Visitor>(matchedSoFar, childLetter);
+      });
    }
    else
    {
-      const auto itWhere = findChild(letter);
-      if (itWhere != m_children.cend())
+      const auto child = FindChild(node, letter);
+      if (child != sc_root)
+      {
+         appendLetter<Visitor>(matchedSoFar, letter);
+         findMask(child, mask, maskIndex, pos, letterCount - 1, alphabet, matchedSoFar, visitor);
+         removeLetter<Visitor>(matchedSoFar, letter);
+      }
+   }
+}
+
+template<typename Visitor>
+void TrieNodePool::findMasks(NodeIndex node, const StringViewVec& masks, MaskPositionVec& positions, size_t first, size_t last,
+   const unicode::Alphabet& alphabet, std::string& matchedSoFar, Visitor& visitor) const
+{
+   if (last - first == 1)
+   {
+      // the rest of the subtree is matched by one mask
+      const auto& maskPosition = positions[first];
+      findMask(node, masks[maskPosition.mask], maskPosition.mask, maskPosition.pos, maskPosition.letterCount, alphabet, matchedSoFar, visitor);
+      return;
+   }
+
+   // masks are dropped below nodes without words of their remaining length
+   const auto& trieNode = m_nodes[node];
+   const auto hasWordAt = [&trieNode](const MaskPosition& maskPosition)
+   {
+      return trieNode.HasWordAt(maskPosition.letterCount);
+   };
+   if (std::none_of(positions.begin() + first, positions.begin() + last, hasWordAt) || !visitor.Enter(trieNode))
+   {
+      return;
+   }
+
+   // masks with the next letter are pushed sorted by the letter, ? precedes letters
+   // the first mask ending here is reported with the word
+   uint32_t endedMask = gc_noMask;
+   const size_t anyFirst = positions.size();
+   for (size_t i = first; i < last; ++i)
+   {
+      const auto maskPosition = positions[i];
+      if (!hasWordAt(maskPosition))
+      {
+         continue;
+      }
+      const auto mask = masks[maskPosition.mask];
+      if (maskPosition.pos == mask.size())
+      {
+         endedMask = std::min(endedMask, maskPosition.mask);
+         continue;
+      }
+      size_t pos = maskPosition.pos;
+      const auto letter = readMaskLetter(mask, pos);
+      positions.push_back({ maskPosition.mask, static_cast<uint32_t>(pos), letter, maskPosition.letterCount - 1 });
+   }
+   std::sort(positions.begin() + anyFirst, positions.end(), [](const MaskPosition& left, const MaskPosition& right)
+   {
+      return left.letter < right.letter;
+   });
+   const size_t letterLast = positions.size();
+   const size_t letterFirst = std::find_if(positions.begin() + anyFirst, positions.end(), [](const MaskPosition& maskPosition)
+   {
+      return maskPosition.letter != static_cast<char32_t>(sc_anyLetter);
+   }) - positions.begin();
+
+   if (endedMask != gc_noMask && trieNode.CanBeTerminal())
+   {
+      visitor.Found(node, trieNode, matchedSoFar, endedMask);
+   }
+
+   // every child gets all ? masks and the masks with its letter
+   const auto descend = [&](NodeIndex child, size_t letterGroupFirst, size_t letterGroupLast, bool withAnyLetter)
+   {
+      const auto childLetter = m_nodes[child].GetLetter();
+      const size_t childFirst = positions.size();
+      if (withAnyLetter)
+      {
+         for (size_t i = anyFirst; i < letterFirst; ++i)
+         {
+            positions.push_back(positions[i]);
+         }
+      }
+      for (size_t i = letterGroupFirst; i < letterGroupLast; ++i)
+      {
+         positions.push_back(positions[i]);
+      }
+      appendLetter<Visitor>(matchedSoFar, childLetter);
+      findMasks(child, masks, positions, childFirst, positions.size(), alphabet, matchedSoFar, visitor);
+      removeLetter<Visitor>(matchedSoFar, childLetter);
+      positions.resize(childFirst);
+   };
+   const auto findLetterGroupEnd = [&positions, letterLast](size_t groupFirst)
+   {
+      size_t groupLast = groupFirst;
+      while (groupLast < letterLast && positions[groupLast].letter == positions[groupFirst].letter)
       {
-         const auto newMatchedSoFar = matchedSoFar + itWhere->GetLetter();
-         itWhere->FindAll(newMatchedSoFar, rest, onFound);
+         ++groupLast;
       }
+      return groupLast;
+   };
+
+   const bool hasAnyLetter = anyFirst != letterFirst;
+   if (hasAnyLetter)
+   {
+      // children come in the letter order, so do the letter groups
+      size_t groupFirst = letterFirst;
+      forEachChild(node, alphabet, [&](NodeIndex child)
+      {
+         const auto childLetter = m_nodes[child].GetLetter();
+         while (groupFirst < letterLast && positions[groupFirst].letter < childLetter)
+         {
+            groupFirst = findLetterGroupEnd(groupFirst);
+         }
+         const size_t groupLast = groupFirst < letterLast && positions[groupFirst].letter == childLetter ?
+            findLetterGroupEnd(groupFirst) : groupFirst;
+         descend(child, groupFirst, groupLast, true);
+         groupFirst = groupLast;
+      });
    }
+
+   for (size_t groupFirst = letterFirst; groupFirst < letterLast;)
+   {
+      const size_t groupLast = findLetterGroupEnd(groupFirst);
+      const auto letter = positions[groupFirst].letter;
+      // letters out of the alphabet are not reached by ? masks
+      if (!hasAnyLetter || !isInAlphabet(alphabet, letter))
+      {
+         const auto child = FindChild(node, letter);
+         if (child != sc_root)
+         {
+            descend(child, groupFirst, groupLast, false);
+         }
+      }
+      groupFirst = groupLast;
+   }
+
+   positions.resize(anyFirst);
 }
 
+void TrieNodePool::Relayout(const std::vector<uint32_t>& visits)
+{
+   assert(visits.size() == m_nodes.size());
+
+   // visited nodes first in DFS preorder, the hottest child right after its parent
+   std::vector<NodeIndex> order;
+   order.reserve(m_nodes.size());
+   std::vector<NodeIndex> stack{ sc_root };
+   std::vector<NodeIndex> visitedChildren;
+   while (!stack.empty())
+   {
+      const auto node = stack.back();
+      stack.pop_back();
+      order.push_back(node);
+      visitedChildren.clear();
+      forEachChild(node, [&visits, &visitedChildren](NodeIndex child)
+      {
+         if (visits[child] != 0)
+         {
+            visitedChildren.push_back(child);
+         }
+      });
+      std::stable_sort(visitedChildren.begin(), visitedChildren.end(), [&visits](NodeIndex left, NodeIndex right)
+      {
+         return visits[left] < visits[right];
+      });
+      stack.insert(stack.end(), visitedChildren.begin(), visitedChildren.end());
+   }
+   // then the cold nodes in BFS order, siblings next to each other
+   for (size_t i = 0; i < order.size(); ++i)
+   {
+      forEachChild(order[i], [&visits, &order](NodeIndex child)
+      {
+         if (visits[child] == 0)
+         {
+            order.push_back(child);
+         }
+      });
+   }
+   assert(order.size() == m_nodes.size());
+
+   std::vector<NodeIndex> newIndices(m_nodes.size());
+   for (size_t i = 0; i < order.size(); ++i)
+   {
+      newIndices[order[i]] = static_cast<NodeIndex>(i);
+   }
+
+   std::pmr::vector<TrieNode> nodes(GetMemoryResource());
+   nodes.reserve(m_nodes.size());
+   std::pmr::vector<NodeIndex> parents(GetMemoryResource());
+   parents.reserve(m_parents.size());
+   std::pmr::vector<SpilledChildVec> spilledChildren(GetMemoryResource());
+   spilledChildren.reserve(m_spilledChildren.size());
+   for (const auto oldIndex : order)
+   {
+      parents.push_back(newIndices[m_parents[oldIndex]]);
+      auto trieNode = m_nodes[oldIndex];
+      if (trieNode.IsSpilled())
+      {
+         SpilledChildVec children(m_spilledChildren[trieNode.m_spilledChildren], GetMemoryResource());
+         for (auto& spilledChild : children)
+         {
+            spilledChild.child = newIndices[spilledChild.child];
+         }
+         trieNode.m_spilledChildren = static_cast<uint32_t>(spilledChildren.size());
+         spilledChildren.emplace_back(std::move(children));
+      }
+      else
+      {
+         for (size_t i = 0; i < trieNode.m_inlineChildCount; ++i)
+         {
+            trieNode.m_inlineChildren[i] = newIndices[trieNode.m_inlineChildren[i]];
+         }
+      }
+      nodes.push_back(trieNode);
+   }
+   m_nodes = std::move(nodes);
+   m_parents = std::move(parents);
+   m_spilledChildren = std::move(spilledChildren);
+}
+
+size_t TrieNodePool::MemoryUsage() const
+{
+   size_t bytes = m_nodes.capacity() * sizeof(TrieNode) + m_parents.capacity() * sizeof(NodeIndex) +
+      m_spilledChildren.capacity() * sizeof(m_spilledChildren[0]);
+   for (const auto& children : m_spilledChildren)
+   {
+      bytes += children.capacity() * sizeof(SpilledChild);
+   }
+   return bytes;
 }
 
-}
\ No newline at end of file
+}
+
+}
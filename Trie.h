@@ -1,84 +1,445 @@
 #pragma once
 
+#include "Unicode.h"
+
 #include <string>
+#include <string_view>
 #include <vector>
 #include <functional>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <initializer_list>
+#include <memory_resource>
 
 namespace trie
 {
 
+/// <summary>
+/// Word rank in the dictionary, lower is better (e.g. more frequent)
+/// </summary>
+using Rank = uint32_t;
+using RankedWord = std::pair<Rank, std::string>;
+using RankedWordVec = std::vector<RankedWord>;
+using StringViewVec = std::vector<std::string_view>;
+
+/// <summary>
+/// Word of a dictionary: the index of the node the word ends at. Copies of a trie keep the ids,
+/// <c>Trie::OptimizeLayout</c> renumbers them
+/// </summary>
+using WordId = uint32_t;
+
+/// <summary>
+/// Word found by a multi-mask search, the mask it matched (an index in the searched masks) and the rank read by the walk
+/// </summary>
+struct WordMatch
+{
+   WordId word;
+   uint32_t mask;
+   Rank rank;
+};
+using WordMatchVec = std::vector<WordMatch>;
+
+/// <summary>
+/// Work done by a search
+/// </summary>
+struct SearchStats
+{
+   /// <summary>
+   /// Number of trie nodes entered
+   /// </summary>
+   size_t visitedNodes = 0;
+};
+
+/// <summary>
+/// Keeps at most k distinct words of the best (lowest) rank, a bounded max-heap
+/// </summary>
+class BestWords
+{
+public:
+   explicit BestWords(size_t maxSize)
+      : m_maxSize(maxSize)
+   {
+      m_words.reserve(maxSize);
+   }
+
+   /// <summary>
+   /// Can a word with the rank get into the collection, used to skip subtrees
+   /// </summary>
+   /// <param name="rank"></param>
+   /// <returns>true if there is a free place or the rank is better than the worst one held</returns>
+   bool IsAccepted(Rank rank) const
+   {
+      return m_words.size() < m_maxSize || (!m_words.empty() && rank < m_words.front().first);
+   }
+
+   /// <summary>
+   /// Adds a word if its rank is good enough, the worst word is dropped if the collection is full
+   /// </summary>
+   /// <param name="rank"></param>
+   /// <param name="word"></param>
+   void Add(Rank rank, const std::string& word);
+
+   /// <summary>
+   /// Moves the collected words out
+   /// </summary>
+   /// <returns>Words sorted by rank, the best first</returns>
+   RankedWordVec Take();
+
+private:
+   size_t m_maxSize;
+   RankedWordVec m_words;
+};
+
 namespace internal
 {
 
+/// <summary>
+/// Position of a node in <c>TrieNodePool</c>
+/// </summary>
+using NodeIndex = uint32_t;
+
+/// <summary>
+/// Compact trie node: the letter code point, the terminal flag and the inline child count are packed in 32 bits.
+/// Up to <c>sc_inlineChildren</c> child indices are kept inline, more are spilled to the pool.
+/// Most nodes of a dictionary are leaves or have one child, so they need no extra allocation.
+/// </summary>
 class TrieNode
 {
 public:
-   
+   /// <summary>
+   /// Number of children stored in the node itself
+   /// </summary>
+   static constexpr size_t sc_inlineChildren = 2;
+
+   /// <summary>
+   /// Pseudo letter of the root
+   /// </summary>
+   static constexpr char32_t sc_rootLetter = 0;
+
+   explicit TrieNode(char32_t letter)
+      : m_letter(letter)
+      , m_canBeTerminal(false)
+      , m_isSpilled(false)
+      , m_inlineChildCount(0)
+      , m_rank(std::numeric_limits<Rank>::max())
+      , m_bestRank(std::numeric_limits<Rank>::max())
+      , m_wordLengths(0)
+   {
+      m_inlineChildren[0] = m_inlineChildren[1] = 0;
+   }
+
+   /// <summary>
+   /// Letter code point
+   /// </summary>
+   char32_t GetLetter() const { return m_letter; }
+
+   bool CanBeTerminal() const { return m_canBeTerminal; }
+   bool IsSpilled() const { return m_isSpilled; }
+
+   Rank GetRank() const { return m_rank; }
+   Rank GetBestRank() const { return m_bestRank; }
+
+   /// <summary>
+   /// Marks the end of a word, the best rank is kept for duplicates
+   /// </summary>
+   /// <returns>true if the node has not been the end of a word before</returns>
+   bool SetTerminal(Rank rank);
+
+   /// <summary>
+   /// Lowers the best rank of the subtree when a word is added below the node
+   /// </summary>
+   void LowerBestRank(Rank rank) { m_bestRank = std::min(m_bestRank, rank); }
+
+   /// <summary>
+   /// Does a word end the given number of letters below the node, distances from
+   /// <c>sc_maxWordDistance</c> on are not told apart
+   /// </summary>
+   bool HasWordAt(size_t distance) const { return (m_wordLengths & getDistanceBit(distance)) != 0; }
+
+   /// <summary>
+   /// Notes a word ending the given number of letters below the node
+   /// </summary>
+   void AddWordAt(size_t distance) { m_wordLengths |= getDistanceBit(distance); }
+
+   /// <summary>
+   /// Notes the words ending below a child
+   /// </summary>
+   void AddChildWords(const TrieNode& child)
+   {
+      m_wordLengths |= (child.m_wordLengths << 1) | (child.m_wordLengths & getDistanceBit(sc_maxWordDistance));
+   }
+
+   /// <summary>
+   /// The last distance with an own bit
+   /// </summary>
+   static constexpr size_t sc_maxWordDistance = 31;
+
+private:
+   friend class TrieNodePool;
+
+   static uint32_t getDistanceBit(size_t distance) { return uint32_t(1) << std::min(distance, sc_maxWordDistance); }
+
+   uint32_t m_letter : 21;
+   uint32_t m_canBeTerminal : 1;
+   uint32_t m_isSpilled : 1;
+   uint32_t m_inlineChildCount : 2;
+
+   union
+   {
+      /// <summary>
+      /// Children sorted by letter if not spilled
+      /// </summary>
+      NodeIndex m_inlineChildren[sc_inlineChildren];
+
+      /// <summary>
+      /// Position of the child list in the pool if spilled
+      /// </summary>
+      uint32_t m_spilledChildren;
+   };
+
+   /// <summary>
+   /// Rank of the word ending here if the node can be terminal
+   /// </summary>
+   Rank m_rank;
+
+   /// <summary>
+   /// The best rank of the words in the subtree including this node
+   /// </summary>
+   Rank m_bestRank;
+
+   /// <summary>
+   /// Bit i is set if a word ends i letters below the node, the last bit stands for
+   /// <c>sc_maxWordDistance</c> letters and more. Masks are only matched below nodes
+   /// with words of their remaining length
+   /// </summary>
+   uint32_t m_wordLengths;
+};
+
+/// <summary>
+/// Storage of trie nodes, nodes refer to their children by indices.
+/// The root is at index 0, so 0 is never a child.
+/// </summary>
+class TrieNodePool
+{
+public:
    using StringVec = std::vector<std::string>;
    using FnFound = std::function<void(const std::string&)>;
+   /// <summary>
+   /// Word to add in bulk, refers to the caller's text
+   /// </summary>
+   using RankedWordView = std::pair<Rank, std::string_view>;
+   using RankedWordViewVec = std::vector<RankedWordView>;
+   using RankedWordViewVecConstIt = RankedWordViewVec::const_iterator;
 
    /// <summary>
    /// Symbol to designate any letter in a word
    /// </summary>
    static const char sc_anyLetter = '?';
 
-   explicit TrieNode(char letter)
-      : m_letter(letter) 
-      , m_canBeTerminal(false)
-   {
-      m_children.reserve(size_t('z' - 'a') + 1);
-   }
+   static constexpr NodeIndex sc_root = 0;
+
+   /// <summary>
+   /// Creates a pool with the root
+   /// </summary>
+   /// <param name="resource">memory of the nodes</param>
+   explicit TrieNodePool(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+   TrieNodePool(TrieNodePool&&) = default;
+   TrieNodePool& operator =(TrieNodePool&&) = default;
+
+   /// <summary>
+   /// Copies the nodes to the same resource, the memory is allocated and first touched by the calling thread
+   /// </summary>
+   TrieNodePool Clone() const;
 
-   TrieNode(TrieNode&&) = default;
-   TrieNode& operator =(TrieNode&&) = default;
+   std::pmr::memory_resource* GetMemoryResource() const { return m_nodes.get_allocator().resource(); }
+
+   const TrieNode& operator [](NodeIndex node) const { return m_nodes[node]; }
+   TrieNode& operator [](NodeIndex node) { return m_nodes[node]; }
+
+   size_t GetChildCount(NodeIndex node) const;
+
+   /// <summary>
+   /// Parent of a node, the root is its own parent
+   /// </summary>
+   NodeIndex GetParent(NodeIndex node) const { return m_parents[node]; }
+
+   /// <summary>
+   /// Letters from the root to the node
+   /// </summary>
+   /// <returns>UTF-8 word</returns>
+   std::string GetWord(NodeIndex node) const;
+
+   size_t GetNodeCount() const { return m_nodes.size(); }
+
+   /// <summary>
+   /// Finds the child with the given letter, spilled child lists up to <c>sc_linearSearchMax</c> long are scanned
+   /// </summary>
+   /// <param name="node"></param>
+   /// <param name="letter">Letter code point</param>
+   /// <returns>The child index, 0 if not found</returns>
+   NodeIndex FindChild(NodeIndex node, char32_t letter) const;
+
+   /// <summary>
+   /// Finds a child with the letter, creates it if there is none. Children added in order are appended.
+   /// </summary>
+   /// <param name="node"></param>
+   /// <param name="letter">Letter code point</param>
+   /// <returns>The child index</returns>
+   NodeIndex GetOrAddChild(NodeIndex node, char32_t letter);
 
    /// <summary>
-   /// Adds a word or its remaining part
+   /// Adds a word or its remaining part below the node
    /// </summary>
-   /// <param name="suffix"></param>
-   void AddSuffix(const std::string& suffix);
+   /// <param name="node"></param>
+   /// <param name="suffix">UTF-8 letters</param>
+   /// <param name="rank">rank of the word, the best one is kept for duplicates</param>
+   void AddSuffix(NodeIndex node, std::string_view suffix, Rank rank);
 
    /// <summary>
-   /// Finds all words matching the mask
+   /// Adds words sharing the prefix the node ends, children are appended if the input is sorted
    /// </summary>
-   /// <param name="matchedSoFar"></param>
-   /// <param name="mask">a-z or ? (any of a-z)</param>
+   /// <param name="node"></param>
+   /// <param name="first">beginning of a range of words sorted by text, all at least <c>depth</c> bytes long</param>
+   /// <param name="last">end of the range</param>
+   /// <param name="depth">bytes of the prefix already matched</param>
+   void AddSortedSuffixes(NodeIndex node, RankedWordViewVecConstIt first, RankedWordViewVecConstIt last, size_t depth);
+
+   /// <summary>
+   /// Moves nodes of another pool below a node without children, the other root is the node itself
+   /// </summary>
+   /// <param name="node">node without children</param>
+   /// <param name="other">pool to move</param>
+   void Attach(NodeIndex node, TrieNodePool&& other);
+
+   /// <summary>
+   /// Finds all words matching any of the masks walking the trie once: masks sharing a prefix
+   /// descend it together and every node is entered at most once, so every word is found once
+   /// </summary>
+   /// <param name="masks">UTF-8 letters or ? (any letter of the alphabet)</param>
+   /// <param name="alphabet">letters ? stands for</param>
    /// <param name="onFound">Function to call if a word found</param>
-   void FindAll(const std::string& matchedSoFar, const std::string& mask, const FnFound& onFound) const;
+   /// <param name="stats">visited nodes are counted if not null</param>
+   void FindAll(const StringViewVec& masks, const unicode::Alphabet& alphabet, const FnFound& onFound, SearchStats* stats) const;
+
+   /// <summary>
+   /// Finds all words matching any of the masks walking the trie once, every word with the first mask it matches
+   /// </summary>
+   /// <param name="masks">UTF-8 letters or ? (any letter of the alphabet)</param>
+   /// <param name="alphabet">letters ? stands for</param>
+   /// <param name="matches">found words are appended in the walk order</param>
+   /// <param name="stats">visited nodes are counted if not null</param>
+   void FindAll(const StringViewVec& masks, const unicode::Alphabet& alphabet, WordMatchVec& matches, SearchStats* stats) const;
+
+   /// <summary>
+   /// Finds the best ranked words matching any of the masks walking the trie once
+   /// </summary>
+   /// <param name="masks">UTF-8 letters or ? (any letter of the alphabet)</param>
+   /// <param name="alphabet">letters ? stands for</param>
+   /// <param name="best">Words collected so far</param>
+   void FindBest(const StringViewVec& masks, const unicode::Alphabet& alphabet, BestWords& best) const;
+
+   /// <summary>
+   /// Renumbers nodes: nodes visited by the profile first in DFS preorder with the hottest child right after
+   /// its parent, then the rest in the BFS order. The hottest paths lie in compact ranges at the start of the pool
+   /// </summary>
+   /// <param name="visits">number of profile visits of every node, a node is visited at least as often as its children</param>
+   void Relayout(const std::vector<uint32_t>& visits);
+
+   /// <summary>
+   /// Bytes allocated for nodes, their parents and spilled child lists
+   /// </summary>
+   size_t MemoryUsage() const;
+
+   size_t GetWordCount() const { return m_wordCount; }
 
-   char GetLetter() const { return m_letter; }
 private:
-   TrieNode(const TrieNode&) = delete;
-   TrieNode& operator =(const TrieNode&) = delete;
+   TrieNodePool(const TrieNodePool&) = delete;
+   TrieNodePool& operator =(const TrieNodePool&) = delete;
+
+   /// <summary>
+   /// Child of a node with many children: the letter is kept next to the index,
+   /// so a search reads the packed list instead of the child nodes
+   /// </summary>
+   struct SpilledChild
+   {
+      char32_t letter;
+      NodeIndex child;
+   };
+   using SpilledChildVec = std::pmr::vector<SpilledChild>;
+
+   /// <summary>
+   /// Longest spilled child list searched linearly
+   /// </summary>
+   static constexpr size_t sc_linearSearchMax = 8;
+
+   NodeIndex addNode(NodeIndex parent, char32_t letter);
+   void insertChild(NodeIndex node, size_t where, NodeIndex child);
+
+   /// <summary>
+   /// Calls the function for every child in the letter order
+   /// </summary>
+   template<typename Fn>
+   void forEachChild(NodeIndex node, Fn fn) const;
+
+   /// <summary>
+   /// Calls the function for every child with a letter of the alphabet
+   /// </summary>
+   template<typename Fn>
+   void forEachChild(NodeIndex node, const unicode::Alphabet& alphabet, Fn fn) const;
+
+   /// <summary>
+   /// A mask being matched: its index and the byte position the node matches up to
+   /// </summary>
+   struct MaskPosition
+   {
+      uint32_t mask;
+      uint32_t pos;
+      /// <summary>
+      /// Next mask letter, set while the masks of a node are split among its children
+      /// </summary>
+      char32_t letter;
+      /// <summary>
+      /// Number of mask letters after the position
+      /// </summary>
+      uint32_t letterCount;
+   };
+   using MaskPositionVec = std::vector<MaskPosition>;
 
-   using TrieNodeVec = std::vector<TrieNode>;
-   using FoundAndWhere = std::pair<bool, TrieNodeVec::iterator>;
-   
    /// <summary>
-   /// Finds a child with the letter or place to insert into 
+   /// Positions of the masks at the root
    /// </summary>
-   /// <param name="letter"></param>
-   /// <returns>pair: found or not, if found the iterator to, if not where to insert not to break the order</returns>
-   FoundAndWhere findChildOrWhereToInsert(char letter);
+   static MaskPositionVec getStartPositions(const StringViewVec& masks);
 
    /// <summary>
-   /// Finds the child with the given letter
+   /// Matches the masks at <c>positions[first, last)</c> below the node. Subsets for children
+   /// are pushed to the end of <c>positions</c> and popped when the child is done.
+   /// The visitor decides whether to enter a node and collects found words,
+   /// <c>matchedSoFar</c> is only kept if the visitor needs the words spelled out.
+   /// A single mask left is matched by <c>findMask</c>
    /// </summary>
-   /// <param name="letter">Any of a-z</param>
-   /// <returns>A valid iterator, end() if not found</returns>
-   TrieNodeVec::const_iterator findChild(char letter) const;
+   template<typename Visitor>
+   void findMask(NodeIndex node, std::string_view mask, uint32_t maskIndex, size_t pos, size_t letterCount, const unicode::Alphabet& alphabet,
+      std::string& matchedSoFar, Visitor& visitor) const;
+
+   template<typename Visitor>
+   void findMasks(NodeIndex node, const StringViewVec& masks, MaskPositionVec& positions, size_t first, size_t last,
+      const unicode::Alphabet& alphabet, std::string& matchedSoFar, Visitor& visitor) const;
+
+   std::pmr::vector<TrieNode> m_nodes;
 
    /// <summary>
-   /// Letter this node represents
+   /// Parent of every node, kept apart from the nodes as only word ids are spelled out with them
    /// </summary>
-   char m_letter;
+   std::pmr::vector<NodeIndex> m_parents;
 
    /// <summary>
-   /// Is the letter the last one of a word in the dictionary
+   /// Child lists of nodes with more than <c>TrieNode::sc_inlineChildren</c> children
    /// </summary>
-   bool m_canBeTerminal;
+   std::pmr::vector<SpilledChildVec> m_spilledChildren;
 
-   std::vector<TrieNode> m_children;
+   size_t m_wordCount;
 };
 
 }
@@ -96,41 +457,175 @@ private:
 /// Dictionary:  war, was, arc, ark, arm, army
 /// Children inside a node is sorted for O(logN) search
 /// * designates a mark of the end of a word
+/// Letters are Unicode code points, words are UTF-8, words with non-letter symbols are ignored.
+/// ? in masks stands for one letter of an alphabet, e.g. only Cyrillic letters for a Cyrillic word
 /// See https://en.wikipedia.org/wiki/Trie
 /// </summary>
 class Trie
 {
 public:
 
-   using StringVec = internal::TrieNode::StringVec;
+   using StringVec = internal::TrieNodePool::StringVec;
 
-   static const char sc_anyLetter = internal::TrieNode::sc_anyLetter;
+   static const char sc_anyLetter = internal::TrieNodePool::sc_anyLetter;
 
-   Trie();
+   /// <summary>
+   /// <c>AddAll</c> adds fewer words one by one: sorting and starting threads cost more than they save
+   /// </summary>
+   static constexpr size_t sc_minSortedBuildWords = 1024;
 
    /// <summary>
-   /// Adds a word to the tree, ignored if already exists
+   /// Creates an empty tree
+   /// </summary>
+   /// <param name="resource">memory of the nodes, must be thread-safe for <c>AddAll</c> building in parallel</param>
+   explicit Trie(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+   Trie(Trie&&) = default;
+   Trie& operator =(Trie&&) = default;
+
+   /// <summary>
+   /// Copies the tree, e.g. to keep a replica in the memory local to a NUMA node:
+   /// the memory is allocated from the same resource and first touched by the calling thread
+   /// </summary>
+   Trie Clone() const;
+
+   /// <summary>
+   /// Resource the nodes are allocated from
+   /// </summary>
+   std::pmr::memory_resource* GetMemoryResource() const { return m_nodes.GetMemoryResource(); }
+
+   /// <summary>
+   /// Adds a word to the tree, ignored if already exists.
+   /// The word is ranked next after all added before, i.e. in the dictionary order
    /// </summary>
    /// <param name="word">Word to add</param>
    void Add(const std::string& word);
 
+   /// <summary>
+   /// Adds a word with the given rank, the best rank is kept if already exists
+   /// </summary>
+   /// <param name="word">Word to add</param>
+   /// <param name="rank">Rank of the word, e.g. the position in a frequency list</param>
+   void Add(const std::string& word, Rank rank);
+
+   /// <summary>
+   /// Is the word in the tree, ? is a letter here
+   /// </summary>
+   bool Contains(std::string_view word) const;
+
+   /// <summary>
+   /// Finds a word, ? is a letter here
+   /// </summary>
+   /// <param name="word">word to find</param>
+   /// <param name="wordId">id of the word if found</param>
+   /// <returns>false if the word is not in the tree</returns>
+   bool Find(std::string_view word, WordId& wordId) const;
+
    /// <summary>
    /// Finds a word by mask, e.g. was -> was, wa? -> war, was (see trie in the header)
    /// </summary>
-   /// <param name="word">string of a-z and ? symbols</param>
+   /// <param name="word">string of letters and ? symbols</param>
+   /// <param name="script">letters ? stands for, all by default</param>
+   /// <param name="stats">visited nodes are counted if not null</param>
    /// <returns>Collection of matching words</returns>
-   StringVec FindAll(const std::string& mask) const;
+   StringVec FindAll(const std::string& mask, unicode::Script script = unicode::Script::Any, SearchStats* stats = nullptr) const;
+
+   /// <summary>
+   /// Finds words matching any of the masks in one walk, shared mask prefixes are descended once.
+   /// Sorted masks, e.g. from a set, share the most
+   /// </summary>
+   /// <param name="masks">strings of letters and ? symbols</param>
+   /// <param name="script">letters ? stands for, all by default</param>
+   /// <param name="stats">visited nodes are counted if not null</param>
+   /// <returns>Distinct matching words sorted by code points</returns>
+   StringVec FindAll(const StringViewVec& masks, unicode::Script script = unicode::Script::Any, SearchStats* stats = nullptr) const;
+
+   /// <summary>
+   /// Spells a word out
+   /// </summary>
+   /// <param name="word">id found in this trie or a copy of it</param>
+   /// <returns>UTF-8 word</returns>
+   std::string GetWord(WordId word) const { return m_nodes.GetWord(word); }
+
+   /// <summary>
+   /// Rank of a word
+   /// </summary>
+   /// <param name="word">id found in this trie or a copy of it</param>
+   Rank GetRank(WordId word) const { return m_nodes[word].GetRank(); }
+
+   /// <summary>
+   /// Finds the words matching any of the masks in one walk, every word with the first of the masks it matches,
+   /// e.g. to tell the edits a correction is made by
+   /// </summary>
+   /// <param name="masks">strings of letters and ? symbols</param>
+   /// <param name="script">letters ? stands for, all by default</param>
+   /// <param name="stats">visited nodes are counted if not null</param>
+   /// <returns>Distinct words sorted by id</returns>
+   WordMatchVec FindAllMatches(const StringViewVec& masks, unicode::Script script = unicode::Script::Any, SearchStats* stats = nullptr) const;
+
+   /// <summary>
+   /// Finds the best ranked words by mask, adds them to the already collected ones.
+   /// Call with several masks to get the best words matching any of them
+   /// </summary>
+   /// <param name="mask">string of letters and ? symbols</param>
+   /// <param name="best">Collection to update</param>
+   /// <param name="script">letters ? stands for, all by default</param>
+   void FindBest(const std::string& mask, BestWords& best, unicode::Script script = unicode::Script::Any) const;
+
+   /// <summary>
+   /// Finds the best ranked words matching any of the masks in one walk
+   /// </summary>
+   /// <param name="masks">strings of letters and ? symbols</param>
+   /// <param name="best">Collection to update</param>
+   /// <param name="script">letters ? stands for, all by default</param>
+   void FindBest(const StringViewVec& masks, BestWords& best, unicode::Script script = unicode::Script::Any) const;
+
+   /// <summary>
+   /// Adds a collection of words at once. Words are sorted and sharded by the first letter
+   /// (or the first two if there are less letters than cores), every shard subtree is built in parallel.
+   /// Scales better than <c>Add</c> calls for large dictionaries, small ones are added by <c>Add</c>.
+   /// </summary>
+   /// <param name="words">Words to add in the dictionary order, duplicates and already existing words are ignored</param>
+   void AddAll(const StringVec& words);
+
+   /// <summary>
+   /// Adds a collection of words referring to a text, e.g. a memory-mapped file, without copying them
+   /// </summary>
+   /// <param name="words">Words to add in the dictionary order, duplicates and already existing words are ignored</param>
+   void AddAll(const StringViewVec& words);
+
+   void AddAll(std::initializer_list<std::string_view> words) { AddAll(StringViewVec(words)); }
+
+   /// <summary>
+   /// Lays the nodes out for the lookups of a sample, e.g. words of a typical text:
+   /// nodes of the sample word paths go first, the most frequent continuation right after its prefix,
+   /// the rest follow in the BFS order. Without a sample just puts siblings next to each other
+   /// </summary>
+   /// <param name="sampleWords">words, repeated as often as they are looked up</param>
+   void OptimizeLayout(const StringViewVec& sampleWords);
+
+   /// <summary>
+   /// Number of distinct words in the tree
+   /// </summary>
+   size_t GetWordCount() const { return m_nodes.GetWordCount(); }
+
+   /// <summary>
+   /// Bytes taken by the tree, divide by <c>GetWordCount</c> to get bytes per word
+   /// </summary>
+   size_t MemoryUsage() const;
 
 private:
    Trie(const Trie&) = delete;
    Trie& operator =(const Trie&) = delete;
 
+   static bool isValidWord(std::string_view word);
+
+   internal::TrieNodePool m_nodes;
+
    /// <summary>
-   /// pseudo letter to create a root
+   /// Rank of the next word added without the explicit one
    /// </summary>
-   static const char sc_rootLetter = char(-1);
-
-   internal::TrieNode m_root;
+   Rank m_nextRank;
 };
 
 }
\ No newline at end of file
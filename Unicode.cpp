@@ -0,0 +1,353 @@
+#include "Unicode.h"
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+namespace unicode
+{
+
+namespace
+{
+
+/// <summary>
+/// Upper case letters mapped to lower case ones by adding <c>delta</c>.
+/// Every <c>stride</c>-th code point starting from <c>first</c> is an upper case letter
+/// </summary>
+struct CaseRange
+{
+   char32_t first;
+   char32_t last;
+   int delta;
+   char32_t stride;
+};
+
+const CaseRange gc_caseRanges[] =
+{
+   { 0x0041, 0x005A,  32, 1 }, // ASCII
+   { 0x00C0, 0x00D6,  32, 1 }, // Latin-1
+   { 0x00D8, 0x00DE,  32, 1 },
+   { 0x0100, 0x012F,   1, 2 }, // Latin Extended-A
+   { 0x0132, 0x0137,   1, 2 },
+   { 0x0139, 0x0148,   1, 2 },
+   { 0x014A, 0x0177,   1, 2 },
+   { 0x0178, 0x0178, -121, 1 },
+   { 0x0179, 0x017E,   1, 2 },
+   { 0x0386, 0x0386,  38, 1 }, // Greek
+   { 0x0388, 0x038A,  37, 1 },
+   { 0x038C, 0x038C,  64, 1 },
+   { 0x038E, 0x038F,  63, 1 },
+   { 0x0391, 0x03A1,  32, 1 },
+   { 0x03A3, 0x03AB,  32, 1 },
+   { 0x0400, 0x040F,  80, 1 }, // Cyrillic
+   { 0x0410, 0x042F,  32, 1 },
+   { 0x0460, 0x0481,   1, 2 },
+   { 0x048A, 0x04BF,   1, 2 },
+   { 0x04D0, 0x04FF,   1, 2 },
+   { 0x0531, 0x0556,  48, 1 }, // Armenian
+};
+
+struct ScriptRange
+{
+   CodePointRange range;
+   Script script;
+};
+
+/// <summary>
+/// Letters of the supported scripts, sorted
+/// </summary>
+const ScriptRange gc_scriptRanges[] =
+{
+   { { 0x0041, 0x005A }, Script::Latin },
+   { { 0x0061, 0x007A }, Script::Latin },
+   { { 0x00C0, 0x00D6 }, Script::Latin },
+   { { 0x00D8, 0x00F6 }, Script::Latin },
+   { { 0x00F8, 0x024F }, Script::Latin },
+   { { 0x0386, 0x0386 }, Script::Greek },
+   { { 0x0388, 0x038A }, Script::Greek },
+   { { 0x038C, 0x038C }, Script::Greek },
+   { { 0x038E, 0x03A1 }, Script::Greek },
+   { { 0x03A3, 0x03CE }, Script::Greek },
+   { { 0x0400, 0x0481 }, Script::Cyrillic },
+   { { 0x048A, 0x052F }, Script::Cyrillic },
+   { { 0x0531, 0x0556 }, Script::Armenian },
+   { { 0x0561, 0x0587 }, Script::Armenian },
+   { { 0x05D0, 0x05EA }, Script::Hebrew },
+   { { 0x0620, 0x064A }, Script::Arabic },
+   { { 0x0671, 0x06D3 }, Script::Arabic },
+   { { 0x1E00, 0x1EFF }, Script::Latin },
+   { { 0x3041, 0x3096 }, Script::Hiragana },
+   { { 0x30A1, 0x30FA }, Script::Katakana },
+   { { 0x4E00, 0x9FFF }, Script::Han },
+   { { 0xAC00, 0xD7A3 }, Script::Hangul },
+};
+
+const ScriptRange* findScriptRange(char32_t codePoint)
+{
+   const auto itRange = std::lower_bound(std::begin(gc_scriptRanges), std::end(gc_scriptRanges), codePoint,
+      [](const ScriptRange& scriptRange, char32_t letter)
+   {
+      return scriptRange.range.last < letter;
+   });
+   if (itRange != std::end(gc_scriptRanges) && itRange->range.first <= codePoint)
+   {
+      return itRange;
+   }
+   return nullptr;
+}
+
+Alphabet createAlphabet(Script script)
+{
+   if (script == Script::Any)
+   {
+      return { { 0, gc_maxCodePoint } };
+   }
+
+   Alphabet alphabet;
+   for (const auto& scriptRange : gc_scriptRanges)
+   {
+      if (scriptRange.script == script)
+      {
+         alphabet.push_back(scriptRange.range);
+      }
+   }
+   return alphabet;
+}
+
+bool isContinuation(unsigned char byte)
+{
+   return (byte & 0xC0) == 0x80;
+}
+
+}
+
+bool IsAscii(std::string_view text)
+{
+   return std::all_of(text.cbegin(), text.cend(), [](char symbol) { return IsAscii(symbol); });
+}
+
+char32_t Decode(std::string_view text, size_t& pos)
+{
+   assert(pos < text.size());
+   const auto lead = static_cast<unsigned char>(text[pos++]);
+   if (lead < 0x80)
+   {
+      return lead;
+   }
+
+   size_t length = 0;
+   char32_t codePoint = 0;
+   char32_t minCodePoint = 0;
+   if ((lead & 0xE0) == 0xC0)
+   {
+      length = 1;
+      codePoint = lead & 0x1F;
+      minCodePoint = 0x80;
+   }
+   else if ((lead & 0xF0) == 0xE0)
+   {
+      length = 2;
+      codePoint = lead & 0x0F;
+      minCodePoint = 0x800;
+   }
+   else if ((lead & 0xF8) == 0xF0)
+   {
+      length = 3;
+      codePoint = lead & 0x07;
+      minCodePoint = 0x10000;
+   }
+   else
+   {
+      return gc_invalidCodePoint;
+   }
+
+   if (text.size() - pos < length)
+   {
+      return gc_invalidCodePoint;
+   }
+   for (size_t i = 0; i < length; ++i)
+   {
+      const auto byte = static_cast<unsigned char>(text[pos + i]);
+      if (!isContinuation(byte))
+      {
+         return gc_invalidCodePoint;
+      }
+      codePoint = (codePoint << 6) | (byte & 0x3F);
+   }
+
+   if (codePoint < minCodePoint || codePoint > gc_maxCodePoint ||
+      (0xD800 <= codePoint && codePoint <= 0xDFFF))
+   {
+      return gc_invalidCodePoint;
+   }
+   pos += length;
+   return codePoint;
+}
+
+size_t EncodedLength(char32_t codePoint)
+{
+   if (codePoint < 0x80)
+      return 1;
+   if (codePoint < 0x800)
+      return 2;
+   if (codePoint < 0x10000)
+      return 3;
+   return 4;
+}
+
+void Append(std::string& text, char32_t codePoint)
+{
+   switch (EncodedLength(codePoint))
+   {
+   case 1:
+      text += static_cast<char>(codePoint);
+      break;
+   case 2:
+      text += static_cast<char>(0xC0 | (codePoint >> 6));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+      break;
+   case 3:
+      text += static_cast<char>(0xE0 | (codePoint >> 12));
+      text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+      break;
+   default:
+      text += static_cast<char>(0xF0 | (codePoint >> 18));
+      text += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+      text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+      break;
+   }
+}
+
+std::u32string ToUtf32(std::string_view text)
+{
+   std::u32string result;
+   result.reserve(text.size());
+   for (size_t pos = 0; pos < text.size();)
+   {
+      result += Decode(text, pos);
+   }
+   return result;
+}
+
+std::string ToUtf8(std::u32string_view text)
+{
+   std::string result;
+   result.reserve(text.size());
+   for (const auto codePoint : text)
+   {
+      Append(result, codePoint);
+   }
+   return result;
+}
+
+bool IsLetter(char32_t codePoint)
+{
+   if (codePoint < 0x80)
+   {
+      return IsAsciiLetter(static_cast<char>(codePoint));
+   }
+   return findScriptRange(codePoint) != nullptr;
+}
+
+char32_t ToLower(char32_t codePoint)
+{
+   for (const auto& caseRange : gc_caseRanges)
+   {
+      if (caseRange.first <= codePoint && codePoint <= caseRange.last &&
+         (codePoint - caseRange.first) % caseRange.stride == 0)
+      {
+         return static_cast<char32_t>(static_cast<int>(codePoint) + caseRange.delta);
+      }
+   }
+   return codePoint;
+}
+
+char32_t ToUpper(char32_t codePoint)
+{
+   for (const auto& caseRange : gc_caseRanges)
+   {
+      const auto upperCase = static_cast<char32_t>(static_cast<int>(codePoint) - caseRange.delta);
+      if (caseRange.first <= upperCase && upperCase <= caseRange.last &&
+         (upperCase - caseRange.first) % caseRange.stride == 0)
+      {
+         return upperCase;
+      }
+   }
+   return codePoint;
+}
+
+std::string ToLower(std::string_view text)
+{
+   std::string result(text);
+   if (IsAscii(text))
+   {
+      std::transform(result.begin(), result.end(), result.begin(),
+         [](char c) { return ('A' <= c && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; });
+      return result;
+   }
+
+   result.clear();
+   for (size_t pos = 0; pos < text.size();)
+   {
+      const size_t start = pos;
+      const auto codePoint = Decode(text, pos);
+      if (codePoint == gc_invalidCodePoint)
+      {
+         result.append(text.substr(start, pos - start)); // keep malformed bytes as is
+         continue;
+      }
+      Append(result, ToLower(codePoint));
+   }
+   return result;
+}
+
+Script GetScript(char32_t codePoint)
+{
+   const auto* scriptRange = findScriptRange(codePoint);
+   return scriptRange ? scriptRange->script : Script::Any;
+}
+
+Script GetScript(std::string_view word)
+{
+   Script wordScript = Script::Any;
+   for (size_t pos = 0; pos < word.size();)
+   {
+      Script script = Script::Latin;
+      if (IsAsciiLetter(word[pos]))
+      {
+         ++pos;
+      }
+      else
+      {
+         script = GetScript(Decode(word, pos));
+      }
+      if (script == Script::Any || (wordScript != Script::Any && wordScript != script))
+      {
+         return Script::Any;
+      }
+      wordScript = script;
+   }
+   return wordScript;
+}
+
+const Alphabet& GetAlphabet(Script script)
+{
+   static const Alphabet alphabets[] =
+   {
+      createAlphabet(Script::Any),
+      createAlphabet(Script::Latin),
+      createAlphabet(Script::Greek),
+      createAlphabet(Script::Cyrillic),
+      createAlphabet(Script::Armenian),
+      createAlphabet(Script::Hebrew),
+      createAlphabet(Script::Arabic),
+      createAlphabet(Script::Hiragana),
+      createAlphabet(Script::Katakana),
+      createAlphabet(Script::Han),
+      createAlphabet(Script::Hangul),
+   };
+   return alphabets[static_cast<size_t>(script)];
+}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// <summary>
+/// UTF-8 decoding, letter classification and case folding for the scripts the checker supports.
+/// ASCII is handled inline, other code points go through small range tables.
+/// </summary>
+namespace unicode
+{
+
+/// <summary>
+/// Returned by <c>Decode</c> for a malformed sequence
+/// </summary>
+const char32_t gc_invalidCodePoint = 0xFFFFFFFF;
+
+/// <summary>
+/// Max code point
+/// </summary>
+const char32_t gc_maxCodePoint = 0x10FFFF;
+
+enum class Script
+{
+   Any,      ///< Mixed or unknown, all letters
+   Latin,
+   Greek,
+   Cyrillic,
+   Armenian,
+   Hebrew,
+   Arabic,
+   Hiragana,
+   Katakana,
+   Han,
+   Hangul
+};
+
+/// <summary>
+/// Inclusive range of code points
+/// </summary>
+struct CodePointRange
+{
+   char32_t first;
+   char32_t last;
+};
+
+/// <summary>
+/// Letters of a script, sorted non-overlapping ranges
+/// </summary>
+using Alphabet = std::vector<CodePointRange>;
+
+inline bool IsAscii(char symbol)
+{
+   return static_cast<unsigned char>(symbol) < 0x80;
+}
+
+inline bool IsAsciiLetter(char symbol)
+{
+   return ('a' <= symbol && symbol <= 'z') ||
+          ('A' <= symbol && symbol <= 'Z');
+}
+
+bool IsAscii(std::string_view text);
+
+/// <summary>
+/// Decodes a code point
+/// </summary>
+/// <param name="text">UTF-8 text</param>
+/// <param name="pos">position of the first byte, moved to the next code point. At least 1 byte is always skipped</param>
+/// <returns>The code point or <c>gc_invalidCodePoint</c> for a malformed sequence</returns>
+char32_t Decode(std::string_view text, size_t& pos);
+
+/// <summary>
+/// Appends the UTF-8 encoding of a code point
+/// </summary>
+void Append(std::string& text, char32_t codePoint);
+
+/// <summary>
+/// Number of bytes in the UTF-8 encoding of a code point
+/// </summary>
+size_t EncodedLength(char32_t codePoint);
+
+std::u32string ToUtf32(std::string_view text);
+std::string ToUtf8(std::u32string_view text);
+
+bool IsLetter(char32_t codePoint);
+char32_t ToLower(char32_t codePoint);
+char32_t ToUpper(char32_t codePoint);
+
+/// <summary>
+/// Folds the case of a UTF-8 text, ASCII text is folded byte by byte
+/// </summary>
+std::string ToLower(std::string_view text);
+
+/// <summary>
+/// Script of a letter
+/// </summary>
+/// <returns>Script::Any if not a letter of the supported scripts</returns>
+Script GetScript(char32_t codePoint);
+
+/// <summary>
+/// Common script of the word letters
+/// </summary>
+/// <returns>Script::Any for mixed scripts</returns>
+Script GetScript(std::string_view word);
+
+/// <summary>
+/// Letters of the script, for Script::Any all code points
+/// </summary>
+const Alphabet& GetAlphabet(Script script);
+
+}
@@ -1,13 +1,52 @@
 #include "WordSpellChecker.h"
-#include <cassert>
+#include "Unicode.h"
 #include <thread>
 #include <future>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
 
 namespace
 {
 
 using StringSet = WordSpellChecker::StringSet;
+using Edit = WordSpellChecker::Edit;
+using EditScript = WordSpellChecker::EditScript;
 
+/// <summary>
+/// Edits of a correct word
+/// </summary>
+const EditScript gc_noEdits{};
+
+/// <summary>
+/// Masks with the edits they are made by, for the public masks only
+/// </summary>
+using StringMaskMap = std::map<std::string, EditScript>;
+
+const size_t gc_maskNumberInChunk = 10;
+
+/// <summary>
+/// Adds the words of a chunk to the collected ones, both sorted by word id and distinct, so are the merged.
+/// A word found before keeps its match
+/// </summary>
+template<typename MatchVec>
+void mergeMatches(MatchVec& matches, const MatchVec& chunkMatches)
+{
+   if (chunkMatches.empty())
+   {
+      return;
+   }
+   MatchVec merged;
+   merged.reserve(matches.size() + chunkMatches.size());
+   std::set_union(matches.cbegin(), matches.cend(), chunkMatches.cbegin(), chunkMatches.cend(), std::back_inserter(merged),
+      [](const auto& left, const auto& right)
+   {
+      return left.word < right.word;
+   });
+   matches = std::move(merged);
+}
 
 template<class It>
 constexpr void advanceWithEndChecking(It& it, size_t n, It end)
@@ -17,14 +56,49 @@ constexpr void advanceWithEndChecking(It& it, size_t n, It end)
    }
 }
 
-void createDeletionMasks(const std::string& word, StringSet& oneCorrectionMask, StringSet& twoCorrectionsMask)
+template<typename String>
+Edit makeDeletion(const String& word, size_t pos)
 {
+   return { static_cast<char32_t>(word[pos]), static_cast<uint16_t>(pos), Edit::Type::Deletion };
+}
+
+Edit makeInsertion(size_t pos)
+{
+   // the letter is known when a word matches
+   return { 0, static_cast<uint16_t>(pos), Edit::Type::Insertion };
+}
+
+EditScript makeEditScript(const Edit& edit)
+{
+   EditScript editScript;
+   editScript.edits[editScript.count++] = edit;
+   return editScript;
+}
+
+EditScript makeEditScript(const Edit& first, const Edit& second)
+{
+   EditScript editScript = makeEditScript(first);
+   const bool isSecondFirst = second.position < first.position ||
+      (second.position == first.position && second.type == Edit::Type::Insertion);
+   editScript.edits[isSecondFirst ? 0 : 1] = second;
+   editScript.edits[isSecondFirst ? 1 : 0] = first;
+   editScript.count = 2;
+   return editScript;
+}
+
+// masks and the strings they are made of are allocated like the maps, e.g. in a scratch buffer.
+// A mask made by several edit scripts keeps the first one
+
+template<typename MaskMap>
+void createDeletionMasks(const typename MaskMap::key_type& word, MaskMap& oneCorrectionMask, MaskMap& twoCorrectionsMask)
+{
+   using String = typename MaskMap::key_type;
    // deletion
    for (size_t delPos = 0; delPos < word.size(); ++delPos)
    {
-      auto afterDeletion = word;
+      String afterDeletion(word, oneCorrectionMask.get_allocator());
       afterDeletion.erase(delPos, 1);
-      oneCorrectionMask.insert(afterDeletion);
+      const auto deletion = makeDeletion(word, delPos);
 
       // deletion + deletion
       for (size_t delAgainPos = 0; delAgainPos < afterDeletion.size(); ++delAgainPos)
@@ -33,21 +107,26 @@ void createDeletionMasks(const std::string& word, StringSet& oneCorrectionMask,
          {
             continue; // 2 succeeding deletion
          }
-         auto afterAfterDeletion = afterDeletion;
+         String afterAfterDeletion(afterDeletion, twoCorrectionsMask.get_allocator());
          afterAfterDeletion.erase(delAgainPos, 1);
-         twoCorrectionsMask.emplace(std::move(afterAfterDeletion));
+         const auto deletionAgain = makeDeletion(word, delAgainPos < delPos ? delAgainPos : delAgainPos + 1);
+         twoCorrectionsMask.emplace(std::move(afterAfterDeletion), makeEditScript(deletion, deletionAgain));
       }
+      oneCorrectionMask.emplace(std::move(afterDeletion), makeEditScript(deletion));
    }
 }
 
-void createInsertionMasks(const std::string& word, StringSet& oneCorrectionMask, StringSet& twoCorrectionsMask)
+template<typename MaskMap>
+void createInsertionMasks(const typename MaskMap::key_type& word, MaskMap& oneCorrectionMask, MaskMap& twoCorrectionsMask)
 {
+   using String = typename MaskMap::key_type;
+   const auto anyLetter = typename String::value_type(trie::Trie::sc_anyLetter);
    // insertion
    for (size_t insPos = 0; insPos <= word.size(); ++insPos)
    {
-      auto afterInsertion = word;
-      afterInsertion.insert(afterInsertion.begin() + insPos, 1, trie::Trie::sc_anyLetter);
-      oneCorrectionMask.insert(afterInsertion);
+      String afterInsertion(word, oneCorrectionMask.get_allocator());
+      afterInsertion.insert(afterInsertion.begin() + insPos, 1, anyLetter);
+      const auto insertion = makeInsertion(insPos);
 
       // insertion + insertion
       for (size_t insAgainPos = 0; insAgainPos <= afterInsertion.size(); ++insAgainPos)
@@ -56,19 +135,24 @@ void createInsertionMasks(const std::string& word, StringSet& oneCorrectionMask,
          {
             continue; // 2 succeeding insertion
          }
-         auto afterAfterInsertion = afterInsertion;
-         afterAfterInsertion.insert(afterAfterInsertion.begin() + insAgainPos, 1, trie::Trie::sc_anyLetter);
-         twoCorrectionsMask.emplace(std::move(afterAfterInsertion));
+         String afterAfterInsertion(afterInsertion, twoCorrectionsMask.get_allocator());
+         afterAfterInsertion.insert(afterAfterInsertion.begin() + insAgainPos, 1, anyLetter);
+         const auto insertionAgain = makeInsertion(insAgainPos < insPos ? insAgainPos : insAgainPos - 1);
+         twoCorrectionsMask.emplace(std::move(afterAfterInsertion), makeEditScript(insertion, insertionAgain));
       }
+      oneCorrectionMask.emplace(std::move(afterInsertion), makeEditScript(insertion));
    }
 }
 
-void createInsertionAndDeletionMasks(const std::string& word, StringSet& twoCorrectionsMask)
+template<typename MaskMap>
+void createInsertionAndDeletionMasks(const typename MaskMap::key_type& word, MaskMap& twoCorrectionsMask)
 {
+   using String = typename MaskMap::key_type;
    for (size_t insPos = 0; insPos <= word.size(); ++insPos)
    {
-      auto afterInsertion = word;
-      afterInsertion.insert(afterInsertion.begin() + insPos, 1, trie::Trie::sc_anyLetter);
+      String afterInsertion(word, twoCorrectionsMask.get_allocator());
+      afterInsertion.insert(afterInsertion.begin() + insPos, 1, typename String::value_type(trie::Trie::sc_anyLetter));
+      const auto insertion = makeInsertion(insPos);
 
       for (size_t delPos = 0; delPos < afterInsertion.size(); ++delPos)
       {
@@ -76,87 +160,612 @@ void createInsertionAndDeletionMasks(const std::string& word, StringSet& twoCorr
          {
             continue; // insertion + deletion at the same position -> original
          }
-         auto afterDeletion = afterInsertion;
+         String afterDeletion(afterInsertion, twoCorrectionsMask.get_allocator());
          afterDeletion.erase(delPos, 1);
-         twoCorrectionsMask.emplace(std::move(afterDeletion));
+         const auto deletion = makeDeletion(word, delPos < insPos ? delPos : delPos - 1);
+         twoCorrectionsMask.emplace(std::move(afterDeletion), makeEditScript(insertion, deletion));
       }
    }
 }
 
-}
-
-WordSpellChecker::StringSetPair WordSpellChecker::CreateMasks(const std::string& word)
+template<typename MaskMap>
+std::pair<MaskMap, MaskMap> createMasks(const typename MaskMap::key_type& word)
 {
-   StringSet oneCorrectionMask;
-   StringSet twoCorrectionsMask;
+   const typename MaskMap::allocator_type allocator(word.get_allocator());
+   MaskMap oneCorrectionMask(allocator);
+   MaskMap twoCorrectionsMask(allocator);
    createDeletionMasks(word, oneCorrectionMask, twoCorrectionsMask);
    createInsertionMasks(word, oneCorrectionMask, twoCorrectionsMask);
    createInsertionAndDeletionMasks(word, twoCorrectionsMask);
 
-   return { oneCorrectionMask, twoCorrectionsMask };
+   return { std::move(oneCorrectionMask), std::move(twoCorrectionsMask) };
+}
+
+template<typename MaskMap, typename U32MaskMap>
+MaskMap toUtf8(const U32MaskMap& masks)
+{
+   MaskMap utf8Masks(masks.get_allocator());
+   for (const auto& [mask, editScript] : masks)
+   {
+      const auto utf8Mask = unicode::ToUtf8(std::u32string_view(mask.data(), mask.size()));
+      // UTF-8 keeps the order
+      utf8Masks.emplace_hint(utf8Masks.end(), std::piecewise_construct, std::forward_as_tuple(utf8Mask.begin(), utf8Mask.end()),
+         std::forward_as_tuple(editScript));
+   }
+   return utf8Masks;
+}
+
+/// <summary>
+/// Creates masks of a word, edits are applied to letters, not bytes
+/// </summary>
+template<typename MaskMap>
+std::pair<MaskMap, MaskMap> createWordMasks(const std::string& word, const typename MaskMap::allocator_type& allocator)
+{
+   using String = typename MaskMap::key_type;
+   if (unicode::IsAscii(word))
+   {
+      return createMasks<MaskMap>(String(word.begin(), word.end(), allocator));
+   }
+
+   using U32String = std::basic_string<char32_t, std::char_traits<char32_t>,
+      typename std::allocator_traits<typename MaskMap::allocator_type>::template rebind_alloc<char32_t>>;
+   using U32MaskMap = std::map<U32String, EditScript, std::less<U32String>,
+      typename std::allocator_traits<typename MaskMap::allocator_type>::template rebind_alloc<std::pair<const U32String, EditScript>>>;
+   const auto letters = unicode::ToUtf32(word);
+   const auto& [oneCorrectionMask, twoCorrectionsMask] = createMasks<U32MaskMap>(U32String(letters.begin(), letters.end(), allocator));
+   return { toUtf8<MaskMap>(oneCorrectionMask), toUtf8<MaskMap>(twoCorrectionsMask) };
+}
+
+template<typename MaskMap>
+StringSet getMaskSet(const MaskMap& masks)
+{
+   StringSet maskSet;
+   for (const auto& [mask, editScript] : masks)
+   {
+      maskSet.emplace_hint(maskSet.end(), mask.begin(), mask.end());
+   }
+   return maskSet;
+}
+
+template<typename It>
+trie::StringViewVec getMaskViews(It first, It last)
+{
+   trie::StringViewVec masks;
+   masks.reserve(std::distance(first, last));
+   for (; first != last; ++first)
+   {
+      masks.emplace_back(first->first);
+   }
+   return masks;
+}
+
+}
+
+WordSpellChecker::StringSetPair WordSpellChecker::CreateMasks(const std::string& word)
+{
+   const auto& [oneCorrectionMask, twoCorrectionsMask] = createWordMasks<StringMaskMap>(word, StringMaskMap::allocator_type());
+   return { getMaskSet(oneCorrectionMask), getMaskSet(twoCorrectionsMask) };
+}
+
+bool WordSpellChecker::ApplyEdits(const std::string& word, const EditScript& edits, std::string& edited)
+{
+   const auto letters = unicode::ToUtf32(word);
+   std::u32string editedLetters;
+   const auto* edit = edits.begin();
+   for (size_t pos = 0; pos <= letters.size(); ++pos)
+   {
+      bool isDeleted = false;
+      for (; edit != edits.end() && edit->position == pos; ++edit)
+      {
+         if (edit->type == Edit::Type::Insertion)
+         {
+            editedLetters.push_back(edit->letter);
+         }
+         else if (pos < letters.size() && letters[pos] == edit->letter && !isDeleted)
+         {
+            isDeleted = true;
+         }
+         else
+         {
+            return false;
+         }
+      }
+      if (pos < letters.size() && !isDeleted)
+      {
+         editedLetters.push_back(letters[pos]);
+      }
+   }
+   if (edit != edits.end())
+   {
+      return false; // past the end of the word or not sorted
+   }
+   edited = unicode::ToUtf8(editedLetters);
+   return true;
 }
 
 WordSpellChecker::SpellCheckingRes WordSpellChecker::CheckSpelling(const std::string& word) const
 {
-   const StringVec exactMatching = m_trie.FindAll(word);
-   if (!exactMatching.empty())
+   WorkBudget budget;
+   return CheckSpelling(word, budget);
+}
+
+WordSpellChecker::RankedSpellCheckingRes WordSpellChecker::CheckSpelling(const std::string& word, size_t maxCandidates) const
+{
+   WorkBudget budget;
+   return CheckSpelling(word, maxCandidates, budget);
+}
+
+WordSpellChecker::DetailedSpellCheckingRes WordSpellChecker::CheckSpellingDetailed(const std::string& word) const
+{
+   WorkBudget budget;
+   return CheckSpellingDetailed(word, budget);
+}
+
+WordSpellChecker::SpellCheckingRes WordSpellChecker::CheckSpelling(const std::string& word, WorkBudget& budget,
+   std::pmr::memory_resource* scratch) const
+{
+   ScratchMasks masks{ ScratchMaskMap(scratch), ScratchMaskMap(scratch) };
+   const auto& [correction, matches] = checkWithinBudget(word, budget, masks);
+   return { correction, toWords(matches) };
+}
+
+WordSpellChecker::DetailedSpellCheckingRes WordSpellChecker::CheckSpellingDetailed(const std::string& word, WorkBudget& budget,
+   std::pmr::memory_resource* scratch) const
+{
+   ScratchMasks masks{ ScratchMaskMap(scratch), ScratchMaskMap(scratch) };
+   auto [correction, matches] = checkWithinBudget(word, budget, masks);
+   return { correction, toCandidates(std::move(matches)) };
+}
+
+std::pair<WordSpellChecker::Correction, WordSpellChecker::MaskMatchVec> WordSpellChecker::checkWithinBudget(const std::string& word,
+   WorkBudget& budget, ScratchMasks& masks) const
+{
+   trie::WordId wordId = 0;
+   if (getDictionary().Find(word, wordId))
+   {
+      return { Correction::No, { { wordId, getDictionary().GetRank(wordId), &gc_noEdits } } };
+   }
+
+   const auto script = unicode::GetScript(word);
+   // the maps share the resource, so the masks are moved, not copied
+   masks = createWordMasks<ScratchMaskMap>(word, masks.first.get_allocator());
+   const auto& [oneCorrectionMask, twoCorrectionsMask] = masks;
+   budget.ForceSpend(oneCorrectionMask.size());
+   bool isExpired = false;
+   auto candidates = checkSpellingAsync(oneCorrectionMask, script, budget, isExpired);
+   if (!candidates.empty())
+   {
+      if (isExpired)
+      {
+         budget.OnDegraded();
+      }
+      return { Correction::One, std::move(candidates) };
+   }
+
+   if (isExpired || !budget.Spend(twoCorrectionsMask.size()))
+   {
+      budget.OnDegraded();
+      return { Correction::Two, {} };
+   }
+   candidates = checkSpellingAsync(twoCorrectionsMask, script, budget, isExpired);
+   if (isExpired)
+   {
+      budget.OnDegraded();
+   }
+   return { Correction::Two, std::move(candidates) };
+}
+
+WordSpellChecker::RankedSpellCheckingRes WordSpellChecker::CheckSpelling(const std::string& word, size_t maxCandidates,
+   WorkBudget& budget, std::pmr::memory_resource* scratch) const
+{
+   if (getDictionary().Contains(word))
    {
-      assert(exactMatching[0] == word);
       return { Correction::No, { word } };
    }
 
-   const auto& [oneCorrectionMask, twoCorrectionsMask] = CreateMasks(word);
-   auto candidates = checkSpellingAsync(oneCorrectionMask);
+   const auto script = unicode::GetScript(word);
+   const auto& [oneCorrectionMask, twoCorrectionsMask] = createWordMasks<ScratchMaskMap>(word, scratch);
+   budget.ForceSpend(oneCorrectionMask.size());
+   bool isExpired = false;
+   auto candidates = findBest(oneCorrectionMask, maxCandidates, script, budget, isExpired);
    if (!candidates.empty())
    {
+      if (isExpired)
+      {
+         budget.OnDegraded();
+      }
       return { Correction::One, candidates };
    }
 
-   candidates = checkSpellingAsync(twoCorrectionsMask);
+   if (isExpired || !budget.Spend(twoCorrectionsMask.size()))
+   {
+      budget.OnDegraded();
+      return { Correction::Two, {} };
+   }
+   candidates = findBest(twoCorrectionsMask, maxCandidates, script, budget, isExpired);
+   if (isExpired)
+   {
+      budget.OnDegraded();
+   }
    return { Correction::Two, candidates };
 }
 
-WordSpellChecker::StringSet WordSpellChecker::checkMasks(const StringSet& masks) const
+/// <summary>
+/// State of a <c>CheckSpellingAsync</c> call shared by its chunks
+/// </summary>
+struct WordSpellChecker::AsyncCheck
+{
+   unicode::Script script;
+   ScratchMasks masks;
+   Executor executor;
+   MatchCallback onChecked;
+   std::shared_ptr<WorkBudget> budget;
+
+   std::mutex mutex;
+   MaskMatchVec candidates;
+   size_t pendingChunks = 0;
+
+   /// <summary>
+   /// Chunks were skipped as the time of the budget is out
+   /// </summary>
+   std::atomic<bool> isExpired{ false };
+};
+
+void WordSpellChecker::CheckSpellingAsync(const std::string& word, const Executor& executor, SpellCheckingCallback onChecked) const
+{
+   CheckSpellingAsync(word, executor, std::move(onChecked), std::make_shared<WorkBudget>());
+}
+
+void WordSpellChecker::CheckSpellingAsync(const std::string& word, size_t maxCandidates, const Executor& executor,
+   RankedSpellCheckingCallback onChecked) const
 {
-   StringSet candidates;
-   for (const auto& mask : masks)
+   CheckSpellingAsync(word, maxCandidates, executor, std::move(onChecked), std::make_shared<WorkBudget>());
+}
+
+void WordSpellChecker::CheckSpellingAsync(const std::string& word, const Executor& executor, SpellCheckingCallback onChecked,
+   std::shared_ptr<WorkBudget> budget) const
+{
+   startAsyncCheck(word, executor, [this, onChecked=std::move(onChecked)](Correction correction, const MaskMatchVec& matches)
    {
-      StringVec corrections = m_trie.FindAll(mask);
-      candidates.insert(corrections.begin(), corrections.end());
+      onChecked({ correction, toWords(matches) });
+   }, std::move(budget));
+}
+
+void WordSpellChecker::CheckSpellingAsync(const std::string& word, size_t maxCandidates, const Executor& executor,
+   RankedSpellCheckingCallback onChecked, std::shared_ptr<WorkBudget> budget) const
+{
+   if (maxCandidates == 0)
+   {
+      // no limit: the masks are matched in chunks as by the unranked check, the words are ranked at the end
+      startAsyncCheck(word, executor, [this, onChecked=std::move(onChecked)](Correction correction, const MaskMatchVec& matches)
+      {
+         onChecked({ correction, toRankedWords(matches) });
+      }, std::move(budget));
+      return;
    }
-   return candidates;
+
+   // the best ranked search is serial, nothing to wait for
+   executor([this, word, maxCandidates, onChecked=std::move(onChecked), budget=std::move(budget)]()
+   {
+      onChecked(CheckSpelling(word, maxCandidates, *budget));
+   });
 }
 
-WordSpellChecker::StringSet WordSpellChecker::checkSpellingAsync(const StringSet& masks) const
+void WordSpellChecker::startAsyncCheck(const std::string& word, const Executor& executor, MatchCallback onMatched,
+   std::shared_ptr<WorkBudget> budget) const
 {
-   const size_t maskNumberInChunk = 10;
+   executor([this, word, executor, onChecked=std::move(onMatched), budget=std::move(budget)]() mutable
+   {
+      trie::WordId wordId = 0;
+      if (getDictionary().Find(word, wordId))
+      {
+         onChecked(Correction::No, { { wordId, getDictionary().GetRank(wordId), &gc_noEdits } });
+         return;
+      }
+
+      auto check = std::make_shared<AsyncCheck>();
+      check->script = unicode::GetScript(word);
+      check->masks = createWordMasks<ScratchMaskMap>(word, std::pmr::get_default_resource());
+      check->executor = std::move(executor);
+      check->onChecked = std::move(onChecked);
+      check->budget = std::move(budget);
+      check->budget->ForceSpend(check->masks.first.size());
+      checkMasksAsync(check, Correction::One);
+   });
+}
 
-   if (masks.size() <= maskNumberInChunk)
+void WordSpellChecker::checkMasksAsync(const std::shared_ptr<AsyncCheck>& check, Correction correction) const
+{
+   const auto onChunkChecked = [this, check, correction](const MaskMatchVec& chunkCandidates)
    {
-      return checkMasks(masks);
+      {
+         std::lock_guard<std::mutex> lock(check->mutex);
+         mergeMatches(check->candidates, chunkCandidates);
+         if (--check->pendingChunks != 0)
+         {
+            return;
+         }
+      }
+
+      // the last chunk continues the check, no other chunk touches the state
+      const bool isExpired = check->isExpired.load(std::memory_order_relaxed);
+      if (correction == Correction::One && check->candidates.empty() && !isExpired)
+      {
+         checkMasksAsync(check, Correction::Two);
+         return;
+      }
+      if (isExpired)
+      {
+         check->budget->OnDegraded();
+      }
+      const auto checkedCorrection = correction == Correction::One && check->candidates.empty() ? Correction::Two : correction;
+      check->onChecked(checkedCorrection, check->candidates);
+   };
+
+   const ScratchMaskMap& masks = correction == Correction::One ? check->masks.first : check->masks.second;
+   if (correction == Correction::Two && !check->budget->Spend(masks.size()))
+   {
+      check->budget->OnDegraded();
+      check->onChecked(Correction::Two, MaskMatchVec());
+      return;
+   }
+   if (masks.size() <= gc_maskNumberInChunk)
+   {
+      check->pendingChunks = 1;
+      onChunkChecked(checkMasks(masks, check->script));
+      return;
    }
 
-   std::vector<std::future<StringSet>> tasks;
+   check->pendingChunks = (masks.size() + gc_maskNumberInChunk - 1) / gc_maskNumberInChunk;
    for (auto start = masks.begin(); start != masks.end();)
    {
       auto end = start;
-      advanceWithEndChecking(end, maskNumberInChunk, masks.end());
-
-      StringSet myMasks(start, end);
+      advanceWithEndChecking(end, gc_maskNumberInChunk, masks.end());
+      check->executor([this, start, end, check, onChunkChecked]()
+      {
+         if (check->budget->IsExpired())
+         {
+            check->isExpired.store(true, std::memory_order_relaxed);
+            onChunkChecked(MaskMatchVec());
+            return;
+         }
+         onChunkChecked(checkMasks(start, end, check->script));
+      });
       start = end;
+   }
+}
+
+WordSpellChecker::MaskMatchVec WordSpellChecker::checkMasks(ScratchMaskMap::const_iterator first, ScratchMaskMap::const_iterator last,
+   unicode::Script script) const
+{
+   // masks of a map are sorted, those sharing a prefix descend it together
+   const auto wordMatches = getDictionary().FindAllMatches(getMaskViews(first, last), script);
 
-      auto fut = std::async(std::launch::async, [myMasks=std::move(myMasks), this]()
+   // a chunk has a few masks, words are found by fewer
+   MaskMatchVec matches;
+   matches.reserve(wordMatches.size());
+   for (const auto& wordMatch : wordMatches)
+   {
+      matches.push_back({ wordMatch.word, wordMatch.rank, &std::next(first, wordMatch.mask)->second });
+   }
+   return matches;
+}
+
+WordSpellChecker::MaskMatchVec WordSpellChecker::checkMasks(const ScratchMaskMap& masks, unicode::Script script) const
+{
+   return checkMasks(masks.begin(), masks.end(), script);
+}
+
+WordSpellChecker::StringVec WordSpellChecker::findBest(const ScratchMaskMap& masks, size_t maxCandidates, unicode::Script script,
+   const WorkBudget& budget, bool& isExpired) const
+{
+   if (maxCandidates == 0)
+   {
+      // no limit: every match, nothing to prune by rank
+      return toRankedWords(checkSpellingAsync(masks, script, budget, isExpired));
+   }
+
+   // the chunks of checkSpellingAsync are walked one by one, sharing the best words found so far,
+   // chunks started after the time is out are skipped
+   trie::BestWords best(maxCandidates);
+   if (masks.size() <= gc_maskNumberInChunk)
+   {
+      getDictionary().FindBest(getMaskViews(masks.begin(), masks.end()), best, script);
+   }
+   else
+   {
+      for (auto start = masks.begin(); start != masks.end();)
       {
-         return checkMasks(myMasks);
-      });
-      tasks.emplace_back(std::move(fut));
+         if (budget.IsExpired())
+         {
+            isExpired = true;
+            break;
+         }
+         auto end = start;
+         advanceWithEndChecking(end, gc_maskNumberInChunk, masks.end());
+         getDictionary().FindBest(getMaskViews(start, end), best, script);
+         start = end;
+      }
+   }
+
+   StringVec candidates;
+   for (auto& [rank, word] : best.Take())
+   {
+      candidates.emplace_back(std::move(word));
+   }
+   return candidates;
+}
+
+WordSpellChecker::MaskMatchVec WordSpellChecker::checkSpellingAsync(const ScratchMaskMap& masks, unicode::Script script,
+   const WorkBudget& budget, bool& isExpired) const
+{
+   if (masks.size() <= gc_maskNumberInChunk)
+   {
+      return checkMasks(masks, script);
+   }
+
+   // chunks started after the time is out are skipped, the tasks are waited for
+   std::atomic<bool> isChunkSkipped{ false };
+   const auto checkChunk = [&budget, &isChunkSkipped, script, this](ScratchMaskMap::const_iterator first,
+      ScratchMaskMap::const_iterator last)
+   {
+      if (budget.IsExpired())
+      {
+         isChunkSkipped.store(true, std::memory_order_relaxed);
+         return MaskMatchVec();
+      }
+      return checkMasks(first, last, script);
+   };
+
+   std::vector<std::future<MaskMatchVec>> tasks;
+   for (auto start = masks.begin(); start != masks.end();)
+   {
+      auto end = start;
+      advanceWithEndChecking(end, gc_maskNumberInChunk, masks.end());
+
+      // the masks outlive the task as its result is waited for
+      if (m_workerPool)
+      {
+         auto task = std::make_shared<std::packaged_task<MaskMatchVec()>>([start, end, &checkChunk]()
+         {
+            return checkChunk(start, end);
+         });
+         tasks.emplace_back(task->get_future());
+         m_workerPool->Post([task]() { (*task)(); });
+      }
+      else
+      {
+         tasks.emplace_back(std::async(std::launch::async, [start, end, &checkChunk]()
+         {
+            return checkChunk(start, end);
+         }));
+      }
+      start = end;
    }
 
-   StringSet result;
+   // chunks are merged in the mask order, so a word keeps the edits of the first mask it matches
+   MaskMatchVec result;
    for (auto& task : tasks)
    {
-      StringSet taskResult = task.get();
-      result.insert(taskResult.begin(), taskResult.end());
+      mergeMatches(result, task.get());
    }
+   isExpired = isExpired || isChunkSkipped.load(std::memory_order_relaxed);
    return result;
 }
+
+void WordSpellChecker::SetWorkerPool(std::shared_ptr<WorkerPool> workerPool)
+{
+   m_replicas.clear();
+   m_workerPool = std::move(workerPool);
+}
+
+void WordSpellChecker::OptimizeLayout(const trie::StringViewVec& sampleWords)
+{
+   m_trie.OptimizeLayout(sampleWords);
+   if (!m_replicas.empty())
+   {
+      ReplicateDictionary();
+   }
+}
+
+void WordSpellChecker::ReplicateDictionary()
+{
+   m_replicas.clear();
+   if (!m_workerPool)
+   {
+      return;
+   }
+
+   // every copy is made on its node, so its memory is allocated there
+   std::vector<trie::Trie> replicas;
+   for (size_t node = 0; node < m_workerPool->GetNodeCount(); ++node)
+   {
+      replicas.emplace_back(m_trie.GetMemoryResource());
+   }
+   m_workerPool->RunOnEveryNode([this, &replicas](size_t node)
+   {
+      replicas[node] = m_trie.Clone();
+   });
+   m_replicas = std::move(replicas);
+}
+
+size_t WordSpellChecker::MemoryUsage() const
+{
+   size_t bytes = m_trie.MemoryUsage();
+   for (const auto& replica : m_replicas)
+   {
+      bytes += replica.MemoryUsage();
+   }
+   return bytes;
+}
+
+WordSpellChecker::StringSet WordSpellChecker::toWords(const MaskMatchVec& matches) const
+{
+   // copies of the dictionary keep the ids, so any of them spells the words
+   const auto& dictionary = getDictionary();
+   StringSet words;
+   for (const auto& match : matches)
+   {
+      words.insert(dictionary.GetWord(match.word));
+   }
+   return words;
+}
+
+WordSpellChecker::StringVec WordSpellChecker::toRankedWords(MaskMatchVec matches) const
+{
+   const auto& dictionary = getDictionary();
+   std::sort(matches.begin(), matches.end(), [](const MaskMatch& left, const MaskMatch& right)
+   {
+      return left.rank < right.rank;
+   });
+   StringVec words;
+   words.reserve(matches.size());
+   for (const auto& match : matches)
+   {
+      words.push_back(dictionary.GetWord(match.word));
+   }
+   return words;
+}
+
+WordSpellChecker::CandidateVec WordSpellChecker::toCandidates(MaskMatchVec matches) const
+{
+   const auto& dictionary = getDictionary();
+   std::sort(matches.begin(), matches.end(), [](const MaskMatch& left, const MaskMatch& right)
+   {
+      return left.rank < right.rank;
+   });
+
+   CandidateVec candidates;
+   candidates.reserve(matches.size());
+   std::u32string letters;
+   for (const auto& match : matches)
+   {
+      Candidate candidate{ dictionary.GetWord(match.word), *match.edits, match.rank };
+      // inserted letters are the correction letters matched by ?: every edit before shifts the position
+      const bool isAscii = unicode::IsAscii(candidate.word);
+      if (!isAscii)
+      {
+         letters = unicode::ToUtf32(candidate.word);
+      }
+      std::ptrdiff_t shift = 0;
+      for (size_t i = 0; i < candidate.edits.count; ++i)
+      {
+         auto& edit = candidate.edits.edits[i];
+         if (edit.type == Edit::Type::Deletion)
+         {
+            --shift;
+            continue;
+         }
+         const auto letterPos = static_cast<size_t>(edit.position + shift++);
+         edit.letter = isAscii ? static_cast<char32_t>(candidate.word[letterPos]) : letters[letterPos];
+      }
+      candidates.push_back(std::move(candidate));
+   }
+   return candidates;
+}
+
+const trie::Trie& WordSpellChecker::getDictionary() const
+{
+   const size_t node = WorkerPool::GetCurrentNode();
+   return node < m_replicas.size() ? m_replicas[node] : m_trie;
+}
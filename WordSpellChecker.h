@@ -1,10 +1,17 @@
 #pragma once
 
 #include "Trie.h"
+#include "WorkerPool.h"
+#include "WorkBudget.h"
 
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
 
 /// <summary>
 /// Class to check a word spelling
@@ -18,15 +25,31 @@ public:
    using StringSet = std::set<std::string>;
    using StringSetPair = std::pair<StringSet, StringSet>;
 
+   /// <summary>
+   /// Creates a checker with an empty dictionary
+   /// </summary>
+   /// <param name="dictionaryResource">memory of the dictionary and its copies, see <c>trie::Trie</c></param>
+   explicit WordSpellChecker(std::pmr::memory_resource* dictionaryResource = std::pmr::get_default_resource())
+      : m_trie(dictionaryResource)
+   {
+   }
+
    /// <summary>
    /// Adds a word to the dictionary
    /// </summary>
    /// <param name="word"></param>
    /// 
    void AddWord(const std::string& word);
+
+   /// <summary>
+   /// Adds a word to the dictionary with the rank, e.g. its position in a frequency list
+   /// </summary>
+   /// <param name="word"></param>
+   /// <param name="rank">lower is better, words are ranked in the order of addition by default</param>
+   void AddWord(const std::string& word, trie::Rank rank);
    template<typename Itr>
    /// <summary>
-   /// Adds words from a collection
+   /// Adds words from a collection, the dictionary is built in parallel
    /// </summary>
    /// <typeparam name="Itr">ForwardIterator type</typeparam>
    /// <param name="first">iterator pointing at the beginning of the collection</param>
@@ -48,6 +71,70 @@ public:
 
    using WordAndCorrection = std::pair<std::string, Correction>;
    using SpellCheckingRes = std::pair<Correction, StringSet>;
+   using RankedSpellCheckingRes = std::pair<Correction, StringVec>;
+
+   /// <summary>
+   /// Letter inserted into or deleted from the checked word to get a correction
+   /// </summary>
+   struct Edit
+   {
+      enum class Type : uint8_t
+      {
+         Insertion, ///< the letter is inserted before the letter at the position (after the last one at the word length)
+         Deletion   ///< the letter at the position is deleted
+      };
+
+      /// <summary>
+      /// Inserted or deleted letter
+      /// </summary>
+      char32_t letter;
+
+      /// <summary>
+      /// Letter position in the checked word, edits of a script refer to the word before any of them
+      /// </summary>
+      uint16_t position;
+
+      Type type;
+   };
+
+   /// <summary>
+   /// Edits turning the checked word into a correction, sorted by position, an insertion precedes a deletion
+   /// at the same position (a substitution)
+   /// </summary>
+   struct EditScript
+   {
+      static constexpr size_t sc_maxEdits = 2;
+
+      Edit edits[sc_maxEdits];
+      uint8_t count = 0;
+
+      const Edit* begin() const { return edits; }
+      const Edit* end() const { return edits + count; }
+   };
+
+   /// <summary>
+   /// Correction with the edits it's made by
+   /// </summary>
+   struct Candidate
+   {
+      std::string word;
+      EditScript edits;
+
+      /// <summary>
+      /// Lower is better: the rank of the word in the dictionary, all candidates of a result take the same number of edits
+      /// </summary>
+      trie::Rank score;
+   };
+   using CandidateVec = std::vector<Candidate>;
+   using DetailedSpellCheckingRes = std::pair<Correction, CandidateVec>;
+
+   /// <summary>
+   /// Runs a task on a caller's thread pool, event loop, etc. Must not run the task inline
+   /// if the caller holds locks the callbacks need
+   /// </summary>
+   using Executor = std::function<void(std::function<void()>)>;
+   using SpellCheckingCallback = std::function<void(SpellCheckingRes)>;
+   using RankedSpellCheckingCallback = std::function<void(RankedSpellCheckingRes)>;
 
    /// <summary>
    /// Creates a collection of masks to match against: insertion is designated by '?'.
@@ -62,32 +149,234 @@ public:
    static StringSetPair CreateMasks(const std::string& word);
 
    /// <summary>
-   /// Checks a word spelling against the built dictionary and suggest corrections
+   /// Applies the edits of a correction to the checked word
+   /// </summary>
+   /// <param name="word">checked word</param>
+   /// <param name="edits">edits of a correction of the word</param>
+   /// <param name="edited">the word with the edits applied</param>
+   /// <returns>false if an edit doesn't fit the word: a position past its end or a deleted letter it doesn't have</returns>
+   static bool ApplyEdits(const std::string& word, const EditScript& edits, std::string& edited);
+
+   /// <summary>
+   /// Checks a word spelling against the built dictionary and suggest corrections.
+   /// Insertions are restricted to the letters of the word script
    /// </summary>
    /// <param name="word">word to check</param>
    /// <returns>0-2 correction to apply + corrected word from the dictionary</returns>
    SpellCheckingRes CheckSpelling(const std::string& word) const;
 
+   /// <summary>
+   /// Checks a word spelling and suggests only the best ranked corrections
+   /// </summary>
+   /// <param name="word">word to check</param>
+   /// <param name="maxCandidates">max number of corrected words to return, 0 for all</param>
+   /// <returns>0-2 correction to apply + up to <c>maxCandidates</c> words, the best ranked first</returns>
+   RankedSpellCheckingRes CheckSpelling(const std::string& word, size_t maxCandidates) const;
+
+   /// <summary>
+   /// Checks a word spelling and tells the edits every correction is made by, e.g. to highlight them.
+   /// The edits are recorded by the search, no diff of the words is needed
+   /// </summary>
+   /// <param name="word">word to check</param>
+   /// <returns>0-2 correction to apply + corrections sorted by score, the best first.
+   /// All corrections of a result take the same number of edits</returns>
+   DetailedSpellCheckingRes CheckSpellingDetailed(const std::string& word) const;
+
+   /// <summary>
+   /// Checks a word spelling within a budget and tells the edits every correction is made by
+   /// </summary>
+   /// <param name="word">word to check</param>
+   /// <param name="budget">budget of the word, counts degraded words</param>
+   /// <param name="scratch">memory of the masks, used by the calling thread only</param>
+   /// <returns>0-2 correction to apply + corrections sorted by score, the best first</returns>
+   DetailedSpellCheckingRes CheckSpellingDetailed(const std::string& word, WorkBudget& budget,
+      std::pmr::memory_resource* scratch = std::pmr::get_default_resource()) const;
+
+   /// <summary>
+   /// Checks a word spelling within a budget. One correction masks are always matched,
+   /// two correction masks only if they fit the budget, otherwise the word is degraded:
+   /// no corrections are returned. Mask chunks started after the time is out are skipped,
+   /// the word is degraded with the corrections found so far
+   /// </summary>
+   /// <param name="word">word to check</param>
+   /// <param name="budget">budget of the word, counts degraded words</param>
+   /// <param name="scratch">memory of the masks, used by the calling thread only, e.g. a monotonic buffer</param>
+   /// <returns>0-2 correction to apply + corrected word from the dictionary</returns>
+   SpellCheckingRes CheckSpelling(const std::string& word, WorkBudget& budget,
+      std::pmr::memory_resource* scratch = std::pmr::get_default_resource()) const;
+
+   /// <summary>
+   /// Checks a word spelling within a budget and suggests only the best ranked corrections
+   /// </summary>
+   /// <param name="word">word to check</param>
+   /// <param name="maxCandidates">max number of corrected words to return, 0 for all</param>
+   /// <param name="budget">budget of the word, counts degraded words</param>
+   /// <param name="scratch">memory of the masks, used by the calling thread only</param>
+   /// <returns>0-2 correction to apply + up to <c>maxCandidates</c> words, the best ranked first</returns>
+   RankedSpellCheckingRes CheckSpelling(const std::string& word, size_t maxCandidates, WorkBudget& budget,
+      std::pmr::memory_resource* scratch = std::pmr::get_default_resource()) const;
+
+   /// <summary>
+   /// Non-blocking <c>CheckSpelling</c>: masks are checked in chunks posted to the executor,
+   /// no executor thread waits for another one. The checker must outlive the call
+   /// </summary>
+   /// <param name="word">word to check</param>
+   /// <param name="executor">runs the chunks</param>
+   /// <param name="onChecked">called on an executor thread with the result</param>
+   void CheckSpellingAsync(const std::string& word, const Executor& executor, SpellCheckingCallback onChecked) const;
+
+   /// <summary>
+   /// Non-blocking <c>CheckSpelling</c> returning the best ranked corrections
+   /// </summary>
+   /// <param name="word">word to check</param>
+   /// <param name="maxCandidates">max number of corrected words to return, 0 for all</param>
+   /// <param name="executor">runs the check, or its mask chunks if all the corrections are returned</param>
+   /// <param name="onChecked">called on an executor thread with the result</param>
+   void CheckSpellingAsync(const std::string& word, size_t maxCandidates, const Executor& executor,
+      RankedSpellCheckingCallback onChecked) const;
+
+   /// <summary>
+   /// Non-blocking <c>CheckSpelling</c> within a budget
+   /// </summary>
+   /// <param name="budget">budget of the word, kept until the check is done</param>
+   void CheckSpellingAsync(const std::string& word, const Executor& executor, SpellCheckingCallback onChecked,
+      std::shared_ptr<WorkBudget> budget) const;
+
+   /// <summary>
+   /// Non-blocking <c>CheckSpelling</c> within a budget returning the best ranked corrections
+   /// </summary>
+   /// <param name="budget">budget of the word, kept until the check is done</param>
+   void CheckSpellingAsync(const std::string& word, size_t maxCandidates, const Executor& executor,
+      RankedSpellCheckingCallback onChecked, std::shared_ptr<WorkBudget> budget) const;
+
+   /// <summary>
+   /// The dictionary, e.g. to get its memory usage
+   /// </summary>
+   const trie::Trie& GetDictionary() const { return m_trie; }
+
+   /// <summary>
+   /// Lays the dictionary out for the words of a sample, see <c>trie::Trie::OptimizeLayout</c>.
+   /// Must not run concurrently with checks
+   /// </summary>
+   /// <param name="sampleWords">words of a typical text</param>
+   void OptimizeLayout(const trie::StringViewVec& sampleWords);
+
+   /// <summary>
+   /// Runs the mask chunks of blocking checks on the pool instead of new threads.
+   /// Blocking checks must not be called on the pool threads then
+   /// </summary>
+   /// <param name="workerPool">pool, null to spawn threads again</param>
+   void SetWorkerPool(std::shared_ptr<WorkerPool> workerPool);
+
+   const std::shared_ptr<WorkerPool>& GetWorkerPool() const { return m_workerPool; }
+
+   /// <summary>
+   /// Copies the dictionary to every NUMA node of the worker pool, pool threads read their local copy.
+   /// Call when the dictionary is built, adding words drops the copies
+   /// </summary>
+   void ReplicateDictionary();
+
+   bool IsDictionaryReplicated() const { return !m_replicas.empty(); }
+
+   /// <summary>
+   /// Bytes taken by the dictionary and its copies
+   /// </summary>
+   size_t MemoryUsage() const;
+
 private:
+   struct AsyncCheck;
+
+   /// <summary>
+   /// Masks of a check with the edits they are made by (letters of insertions are unknown),
+   /// allocated from the scratch resource of the call
+   /// </summary>
+   using ScratchMaskMap = std::pmr::map<std::pmr::string, EditScript>;
+   using ScratchMasks = std::pair<ScratchMaskMap, ScratchMaskMap>;
 
-   StringSet checkMasks(const StringSet& masks) const;
-   StringSet checkSpellingAsync(const StringSet& masks) const;
+   /// <summary>
+   /// Word found by a mask with its rank, the mask outlives the match
+   /// </summary>
+   struct MaskMatch
+   {
+      trie::WordId word;
+      trie::Rank rank;
+      const EditScript* edits;
+   };
+   using MaskMatchVec = std::vector<MaskMatch>;
+
+   // candidates are kept sorted by word id and merged with set_union, words are spelled out for the result only
+   MaskMatchVec checkMasks(ScratchMaskMap::const_iterator first, ScratchMaskMap::const_iterator last, unicode::Script script) const;
+   MaskMatchVec checkMasks(const ScratchMaskMap& masks, unicode::Script script) const;
+   StringVec findBest(const ScratchMaskMap& masks, size_t maxCandidates, unicode::Script script, const WorkBudget& budget,
+      bool& isExpired) const;
+   MaskMatchVec checkSpellingAsync(const ScratchMaskMap& masks, unicode::Script script, const WorkBudget& budget, bool& isExpired) const;
+   void checkMasksAsync(const std::shared_ptr<AsyncCheck>& check, Correction correction) const;
+
+   /// <summary>
+   /// Matches the masks within the budget, the one correction masks first
+   /// </summary>
+   /// <param name="masks">empty maps allocating from the scratch resource, get the masks the matches refer to</param>
+   /// <returns>0-2 correction to apply + the matched words</returns>
+   std::pair<Correction, MaskMatchVec> checkWithinBudget(const std::string& word, WorkBudget& budget, ScratchMasks& masks) const;
+
+   /// <summary>
+   /// Called with the matched words when a non-blocking check is done
+   /// </summary>
+   using MatchCallback = std::function<void(Correction, const MaskMatchVec&)>;
+
+   /// <summary>
+   /// Starts a non-blocking check of all the masks, see <c>CheckSpellingAsync</c>
+   /// </summary>
+   void startAsyncCheck(const std::string& word, const Executor& executor, MatchCallback onMatched,
+      std::shared_ptr<WorkBudget> budget) const;
+
+   /// <summary>
+   /// Spells the matched words out
+   /// </summary>
+   StringSet toWords(const MaskMatchVec& matches) const;
+
+   /// <summary>
+   /// Spells the matched words out, the best ranked first
+   /// </summary>
+   StringVec toRankedWords(MaskMatchVec matches) const;
+
+   /// <summary>
+   /// Spells the matched words out with their edits and scores, the best first
+   /// </summary>
+   CandidateVec toCandidates(MaskMatchVec matches) const;
+
+   /// <summary>
+   /// The dictionary copy local to the calling thread
+   /// </summary>
+   const trie::Trie& getDictionary() const;
 
    trie::Trie m_trie;
+
+   std::shared_ptr<WorkerPool> m_workerPool;
+
+   /// <summary>
+   /// Copies of the dictionary for every node of the worker pool
+   /// </summary>
+   std::vector<trie::Trie> m_replicas;
 };
 
 inline void WordSpellChecker::AddWord(const std::string& word)
 {
+   m_replicas.clear();
    m_trie.Add(word);
 }
 
+inline void WordSpellChecker::AddWord(const std::string& word, trie::Rank rank)
+{
+   m_replicas.clear();
+   m_trie.Add(word, rank);
+}
+
 template<typename Itr>
 inline void WordSpellChecker::AddWords(Itr first, Itr last)
 {
-   for (; first != last; ++first)
-   {
-      AddWord(*first);
-   }
+   m_replicas.clear();
+   m_trie.AddAll(trie::StringViewVec(first, last));
 }
 
 inline void WordSpellChecker::AddWords(std::initializer_list<std::string> list)
@@ -0,0 +1,73 @@
+#include "WorkBudget.h"
+
+WorkBudget::WorkBudget()
+   : WorkBudget(0, Clock::duration::zero())
+{
+}
+
+WorkBudget::WorkBudget(size_t maxMasks, Clock::duration maxTime, WorkBudget* parent)
+   : m_maxMasks(maxMasks)
+   , m_maxTime(maxTime)
+   , m_parent(parent)
+   , m_spentMasks(0)
+   , m_startTime(sc_notStarted)
+   , m_degradedCount(0)
+{
+}
+
+bool WorkBudget::Spend(size_t maskCount)
+{
+   start();
+   if (IsExpired())
+   {
+      return false;
+   }
+
+   const size_t spentMasks = m_spentMasks.fetch_add(maskCount, std::memory_order_relaxed) + maskCount;
+   if ((m_maxMasks != 0 && spentMasks > m_maxMasks) || (m_parent && !m_parent->Spend(maskCount)))
+   {
+      m_spentMasks.fetch_sub(maskCount, std::memory_order_relaxed);
+      return false;
+   }
+   return true;
+}
+
+void WorkBudget::ForceSpend(size_t maskCount)
+{
+   start();
+   m_spentMasks.fetch_add(maskCount, std::memory_order_relaxed);
+   if (m_parent)
+   {
+      m_parent->ForceSpend(maskCount);
+   }
+}
+
+bool WorkBudget::IsExpired() const
+{
+   const auto startTime = m_startTime.load(std::memory_order_relaxed);
+   if (m_maxTime != Clock::duration::zero() && startTime != sc_notStarted &&
+      Clock::now() - Clock::time_point(Clock::duration(startTime)) > m_maxTime)
+   {
+      return true;
+   }
+   return m_parent && m_parent->IsExpired();
+}
+
+void WorkBudget::OnDegraded()
+{
+   m_degradedCount.fetch_add(1, std::memory_order_relaxed);
+   if (m_parent)
+   {
+      m_parent->OnDegraded();
+   }
+}
+
+void WorkBudget::start()
+{
+   if (m_maxTime == Clock::duration::zero() || m_startTime.load(std::memory_order_relaxed) != sc_notStarted)
+   {
+      return;
+   }
+   auto notStarted = sc_notStarted;
+   m_startTime.compare_exchange_strong(notStarted, Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+/// <summary>
+/// Work a check may still do: masks to match and time to spend. A budget can spend from a parent one,
+/// e.g. a word from the budget of its text. The time runs from the first spending.
+/// Thread-safe, chunks of a word spend and check the time concurrently
+/// </summary>
+class WorkBudget
+{
+public:
+   using Clock = std::chrono::steady_clock;
+
+   /// <summary>
+   /// Unlimited budget
+   /// </summary>
+   WorkBudget();
+
+   /// <summary>
+   /// Creates a budget
+   /// </summary>
+   /// <param name="maxMasks">masks to match, 0 for no limit</param>
+   /// <param name="maxTime">time to spend, zero for no limit</param>
+   /// <param name="parent">budget spent from as well, must outlive this one</param>
+   WorkBudget(size_t maxMasks, Clock::duration maxTime, WorkBudget* parent = nullptr);
+
+   /// <summary>
+   /// Takes the masks from this and the parent budgets
+   /// </summary>
+   /// <returns>false, nothing taken, if the masks don't fit or the time is out</returns>
+   bool Spend(size_t maskCount);
+
+   /// <summary>
+   /// Takes the masks even over the limit, for the work never skipped
+   /// </summary>
+   void ForceSpend(size_t maskCount);
+
+   /// <summary>
+   /// The time of this or a parent budget is out
+   /// </summary>
+   bool IsExpired() const;
+
+   /// <summary>
+   /// Counts a word checked with less work than needed, here and in the parent budgets
+   /// </summary>
+   void OnDegraded();
+
+   size_t GetDegradedCount() const { return m_degradedCount.load(std::memory_order_relaxed); }
+
+   size_t GetSpentMasks() const { return m_spentMasks.load(std::memory_order_relaxed); }
+
+private:
+   WorkBudget(const WorkBudget&) = delete;
+   WorkBudget& operator =(const WorkBudget&) = delete;
+
+   void start();
+
+   const size_t m_maxMasks;
+   const Clock::duration m_maxTime;
+   WorkBudget* const m_parent;
+
+   std::atomic<size_t> m_spentMasks;
+
+   /// <summary>
+   /// Time of the first spending since the clock epoch, <c>sc_notStarted</c> before
+   /// </summary>
+   std::atomic<Clock::rep> m_startTime;
+   static constexpr Clock::rep sc_notStarted = Clock::duration::min().count();
+
+   std::atomic<size_t> m_degradedCount;
+};
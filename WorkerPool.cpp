@@ -0,0 +1,265 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+
+thread_local size_t t_currentNode = WorkerPool::sc_noNode;
+
+/// <summary>
+/// Parses a CPU list like 0-3,8,10-11
+/// </summary>
+WorkerPool::CpuVec parseCpuList(const std::string& cpuList)
+{
+   WorkerPool::CpuVec cpus;
+   size_t pos = 0;
+   while (pos < cpuList.size())
+   {
+      size_t end = 0;
+      const auto first = static_cast<unsigned>(std::stoul(cpuList.substr(pos), &end));
+      auto last = first;
+      pos += end;
+      if (pos < cpuList.size() && cpuList[pos] == '-')
+      {
+         ++pos;
+         last = static_cast<unsigned>(std::stoul(cpuList.substr(pos), &end));
+         pos += end;
+      }
+      for (auto cpu = first; cpu <= last; ++cpu)
+      {
+         cpus.push_back(cpu);
+      }
+      pos = cpuList.find_first_of("0123456789", pos);
+   }
+   return cpus;
+}
+
+bool isCpuAvailable(unsigned cpu)
+{
+#ifdef __linux__
+   cpu_set_t cpuSet;
+   CPU_ZERO(&cpuSet);
+   if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) != 0)
+   {
+      return true;
+   }
+   return cpu < CPU_SETSIZE && CPU_ISSET(cpu, &cpuSet);
+#else
+   return cpu < std::thread::hardware_concurrency();
+#endif
+}
+
+/// <summary>
+/// Pins the calling thread to the CPUs, called by a new thread before it does any work:
+/// memory it touches then is local to their node
+/// </summary>
+void pinCurrentThread(const WorkerPool::CpuVec& cpus)
+{
+#ifdef __linux__
+   if (cpus.empty())
+   {
+      return;
+   }
+   cpu_set_t cpuSet;
+   CPU_ZERO(&cpuSet);
+   for (const auto cpu : cpus)
+   {
+      CPU_SET(cpu, &cpuSet);
+   }
+   pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet); // best effort
+#else
+   (void)cpus;
+#endif
+}
+
+}
+
+/// <summary>
+/// Tasks of the pool, owned by the pool and its workers: a worker destroying the pool keeps using it
+/// </summary>
+struct WorkerPool::Queue
+{
+   std::mutex mutex;
+   std::condition_variable hasTasks;
+   std::deque<Task> tasks;
+   bool isStopping = false;
+};
+
+WorkerPool::WorkerPool(const Options& options)
+   : m_queue(std::make_shared<Queue>())
+{
+   const auto topology = GetTopology();
+   size_t threadCount = options.threadCount;
+   if (threadCount == 0)
+   {
+      for (const auto& cpus : topology)
+      {
+         threadCount += cpus.size();
+      }
+   }
+
+   if (!options.pinThreads)
+   {
+      m_nodeCpus.emplace_back();
+      for (size_t i = 0; i < threadCount; ++i)
+      {
+         m_threads.emplace_back([queue = m_queue]() { run(queue, 0); });
+      }
+      return;
+   }
+
+   // fill the nodes one by one, wrap around if there are more workers than cores
+   std::vector<std::pair<size_t, unsigned>> nodeAndCpus;
+   for (size_t node = 0; node < topology.size(); ++node)
+   {
+      for (const auto cpu : topology[node])
+      {
+         nodeAndCpus.emplace_back(node, cpu);
+      }
+   }
+   std::vector<size_t> usedNodes(topology.size(), sc_noNode);
+   for (size_t i = 0; i < threadCount; ++i)
+   {
+      const auto [topologyNode, cpu] = nodeAndCpus[i % nodeAndCpus.size()];
+      if (usedNodes[topologyNode] == sc_noNode)
+      {
+         usedNodes[topologyNode] = m_nodeCpus.size();
+         m_nodeCpus.emplace_back();
+      }
+      const size_t node = usedNodes[topologyNode];
+      m_nodeCpus[node].push_back(cpu);
+      m_threads.emplace_back([queue = m_queue, node, cpu = cpu]()
+      {
+         pinCurrentThread({ cpu });
+         run(queue, node);
+      });
+   }
+}
+
+WorkerPool::~WorkerPool()
+{
+   {
+      std::lock_guard<std::mutex> lock(m_queue->mutex);
+      m_queue->isStopping = true;
+   }
+   m_queue->hasTasks.notify_all();
+   for (auto& thread : m_threads)
+   {
+      // a task dropped the last reference, e.g. the checker owning the pool: its worker can't join itself
+      if (thread.get_id() == std::this_thread::get_id())
+      {
+         thread.detach();
+      }
+      else
+      {
+         thread.join();
+      }
+   }
+}
+
+void WorkerPool::Post(Task task)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_queue->mutex);
+      m_queue->tasks.push_back(std::move(task));
+   }
+   m_queue->hasTasks.notify_one();
+}
+
+std::function<void(WorkerPool::Task)> WorkerPool::GetExecutor()
+{
+   return [pool = shared_from_this()](Task task) { pool->Post(std::move(task)); };
+}
+
+void WorkerPool::RunOnEveryNode(const std::function<void(size_t)>& fn) const
+{
+   std::vector<std::thread> threads;
+   for (size_t node = 0; node < m_nodeCpus.size(); ++node)
+   {
+      threads.emplace_back([&fn, &cpus = m_nodeCpus[node], node]()
+      {
+         pinCurrentThread(cpus);
+         t_currentNode = node;
+         fn(node);
+      });
+   }
+   for (auto& thread : threads)
+   {
+      thread.join();
+   }
+}
+
+size_t WorkerPool::GetCurrentNode()
+{
+   return t_currentNode;
+}
+
+std::vector<WorkerPool::CpuVec> WorkerPool::GetTopology()
+{
+   std::vector<CpuVec> topology;
+#ifdef __linux__
+   for (size_t node = 0; ; ++node)
+   {
+      std::ifstream cpuListFile("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+      std::string cpuList;
+      if (!std::getline(cpuListFile, cpuList))
+      {
+         break;
+      }
+      auto cpus = parseCpuList(cpuList);
+      cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [](unsigned cpu) { return !isCpuAvailable(cpu); }), cpus.end());
+      if (!cpus.empty())
+      {
+         topology.push_back(std::move(cpus));
+      }
+   }
+#endif
+   if (topology.empty())
+   {
+      CpuVec cpus;
+      for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu)
+      {
+         if (isCpuAvailable(cpu))
+         {
+            cpus.push_back(cpu);
+         }
+      }
+      if (cpus.empty())
+      {
+         cpus.push_back(0);
+      }
+      topology.push_back(std::move(cpus));
+   }
+   return topology;
+}
+
+void WorkerPool::run(const std::shared_ptr<Queue>& queue, size_t node)
+{
+   t_currentNode = node;
+   for (;;)
+   {
+      Task task;
+      {
+         std::unique_lock<std::mutex> lock(queue->mutex);
+         queue->hasTasks.wait(lock, [&queue]() { return queue->isStopping || !queue->tasks.empty(); });
+         if (queue->tasks.empty())
+         {
+            return;
+         }
+         task = std::move(queue->tasks.front());
+         queue->tasks.pop_front();
+      }
+      task();
+   }
+}
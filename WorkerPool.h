@@ -0,0 +1,98 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Fixed set of worker threads running posted tasks. Workers can be pinned to cores:
+/// they fill NUMA nodes one by one, so workers sharing a node also share its memory.
+/// Workers know their node, e.g. to read a node-local copy of read-only data.
+/// The workers share the task queue with the pool, so a task may drop the last reference to the pool
+/// </summary>
+class WorkerPool : public std::enable_shared_from_this<WorkerPool>
+{
+public:
+   using Task = std::function<void()>;
+
+   /// <summary>
+   /// CPUs of a NUMA node
+   /// </summary>
+   using CpuVec = std::vector<unsigned>;
+
+   struct Options
+   {
+      /// <summary>
+      /// 0 for a worker per available core
+      /// </summary>
+      size_t threadCount = 0;
+
+      /// <summary>
+      /// Pins every worker to a core, workers of the pool then belong to NUMA nodes
+      /// </summary>
+      bool pinThreads = false;
+   };
+
+   /// <summary>
+   /// Returned by <c>GetCurrentNode</c> outside of pool threads
+   /// </summary>
+   static constexpr size_t sc_noNode = static_cast<size_t>(-1);
+
+   explicit WorkerPool(const Options& options);
+
+   /// <summary>
+   /// Runs the queued tasks and stops the workers. If called by a task, its worker exits after the task
+   /// </summary>
+   ~WorkerPool();
+
+   void Post(Task task);
+
+   /// <summary>
+   /// Function posting tasks to the pool, e.g. <c>WordSpellChecker::Executor</c>.
+   /// Keeps the pool alive, which must be owned by a <c>std::shared_ptr</c>
+   /// </summary>
+   std::function<void(Task)> GetExecutor();
+
+   size_t GetThreadCount() const { return m_threads.size(); }
+
+   /// <summary>
+   /// Number of NUMA nodes the workers run on, 1 if not pinned
+   /// </summary>
+   size_t GetNodeCount() const { return m_nodeCpus.size(); }
+
+   /// <summary>
+   /// Runs the function on a thread of every node the workers run on and waits for all,
+   /// e.g. to allocate memory local to the node. The thread is pinned to the CPUs of the node before the call
+   /// </summary>
+   /// <param name="fn">function taking the node number</param>
+   void RunOnEveryNode(const std::function<void(size_t)>& fn) const;
+
+   /// <summary>
+   /// Node of the calling pool thread, numbered from 0 to <c>GetNodeCount() - 1</c>
+   /// </summary>
+   /// <returns><c>sc_noNode</c> if not called on a pool thread</returns>
+   static size_t GetCurrentNode();
+
+   /// <summary>
+   /// CPUs available to the process grouped by NUMA node, a single node if the topology is unknown
+   /// </summary>
+   static std::vector<CpuVec> GetTopology();
+
+private:
+   WorkerPool(const WorkerPool&) = delete;
+   WorkerPool& operator =(const WorkerPool&) = delete;
+
+   struct Queue;
+
+   static void run(const std::shared_ptr<Queue>& queue, size_t node);
+
+   std::vector<std::thread> m_threads;
+
+   /// <summary>
+   /// CPUs the workers of every node are pinned to, a single empty list if not pinned
+   /// </summary>
+   std::vector<CpuVec> m_nodeCpus;
+
+   std::shared_ptr<Queue> m_queue;
+};
@@ -0,0 +1,190 @@
+#include "../WordSpellChecker.h"
+#include "../InputBuffer.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const char* const gc_defaultDictionary = "../data/50k_most_freq_words.txt";
+const size_t gc_misspelledWordCount = 2000;
+
+using StringVec = WordSpellChecker::StringVec;
+
+/// <summary>
+/// Words made by one random edit of dictionary words, not in the dictionary themselves
+/// </summary>
+StringVec createMisspelledWords(const trie::StringViewVec& dictionary, const WordSpellChecker& checker)
+{
+   std::mt19937 random(1);
+   StringVec words;
+   while (words.size() < gc_misspelledWordCount)
+   {
+      std::string word(dictionary[random() % dictionary.size()]);
+      if (word.size() < 3)
+      {
+         continue;
+      }
+      const size_t pos = random() % word.size();
+      const auto letter = static_cast<char>('a' + random() % 26);
+      switch (random() % 3)
+      {
+      case 0:
+         word.erase(pos, 1);
+         break;
+      case 1:
+         word.insert(word.begin() + pos, letter);
+         break;
+      default:
+         word[pos] = letter;
+         break;
+      }
+      if (checker.GetDictionary().FindAll(word).empty())
+      {
+         words.push_back(std::move(word));
+      }
+   }
+   return words;
+}
+
+/// <summary>
+/// Checks all words on the pool at once
+/// </summary>
+/// <returns>Words per second</returns>
+double measure(const WordSpellChecker& checker, WorkerPool& pool, const StringVec& words)
+{
+   std::mutex mutex;
+   std::condition_variable isDone;
+   size_t pendingWords = words.size();
+
+   const auto start = std::chrono::steady_clock::now();
+   const auto executor = pool.GetExecutor();
+   for (const auto& word : words)
+   {
+      checker.CheckSpellingAsync(word, executor, [&](WordSpellChecker::SpellCheckingRes)
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         if (--pendingWords == 0)
+         {
+            isDone.notify_one();
+         }
+      });
+   }
+   std::unique_lock<std::mutex> lock(mutex);
+   isDone.wait(lock, [&pendingWords]() { return pendingWords == 0; });
+   const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+   return static_cast<double>(words.size()) / duration.count();
+}
+
+std::vector<size_t> getThreadCounts(size_t maxThreadCount)
+{
+   std::vector<size_t> threadCounts;
+   for (size_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+   {
+      threadCounts.push_back(threadCount);
+   }
+   threadCounts.push_back(maxThreadCount);
+   return threadCounts;
+}
+
+}
+
+/// <summary>
+/// Prints scaling curves of the spelling check: words per second for 1..N workers with
+/// unpinned workers, workers pinned to cores and pinned workers reading NUMA node-local dictionary copies
+/// bench [dictionary file] [max thread number]
+/// </summary>
+int main(int argc, char* argv[])
+{
+   const char* dictionaryPath = argc > 1 ? argv[1] : gc_defaultDictionary;
+   size_t maxThreadCount = 0;
+   for (const auto& cpus : WorkerPool::GetTopology())
+   {
+      maxThreadCount += cpus.size();
+   }
+   if (argc > 2)
+   {
+      const int threadCount = std::atoi(argv[2]);
+      if (threadCount <= 0)
+      {
+         std::cout << "Thread number must be a positive number\n";
+         return 1;
+      }
+      maxThreadCount = static_cast<size_t>(threadCount);
+   }
+
+   InputBuffer input;
+   if (!input.Open(dictionaryPath))
+   {
+      std::cout << dictionaryPath << " can't be opened\n";
+      return 1;
+   }
+   trie::StringViewVec dictionary;
+   LineReader reader(input.GetData());
+   for (std::string_view line; reader.NextLine(line);)
+   {
+      ForEachWord(line, [&dictionary](std::string_view word)
+      {
+         dictionary.push_back(word);
+         return true;
+      });
+   }
+   if (dictionary.empty())
+   {
+      std::cout << dictionaryPath << " has no words\n";
+      return 1;
+   }
+
+   WordSpellChecker checker;
+   checker.AddWords(dictionary.begin(), dictionary.end());
+   const auto words = createMisspelledWords(dictionary, checker);
+
+   std::cout << "Dictionary: " << checker.GetDictionary().GetWordCount() << " words, NUMA nodes: "
+      << WorkerPool::GetTopology().size() << ", misspelled words: " << words.size() << "\n";
+   std::cout << std::left << std::setw(16) << "workers" << std::right << std::setw(8) << "threads"
+      << std::setw(8) << "nodes" << std::setw(12) << "words/s" << std::setw(10) << "speedup" << "\n";
+
+   struct Configuration
+   {
+      const char* name;
+      bool pinThreads;
+      bool replicateDictionary;
+   };
+   const Configuration configurations[] =
+   {
+      { "unpinned", false, false },
+      { "pinned", true, false },
+      { "pinned+replica", true, true },
+   };
+   for (const auto& configuration : configurations)
+   {
+      double singleThreadSpeed = 0;
+      for (const auto threadCount : getThreadCounts(maxThreadCount))
+      {
+         auto pool = std::make_shared<WorkerPool>(WorkerPool::Options{ threadCount, configuration.pinThreads });
+         checker.SetWorkerPool(pool);
+         if (configuration.replicateDictionary)
+         {
+            checker.ReplicateDictionary();
+         }
+
+         const double speed = measure(checker, *pool, words);
+         if (threadCount == 1)
+         {
+            singleThreadSpeed = speed;
+         }
+         std::cout << std::left << std::setw(16) << configuration.name << std::right << std::setw(8) << threadCount
+            << std::setw(8) << pool->GetNodeCount() << std::setw(12) << std::fixed << std::setprecision(0) << speed
+            << std::setw(10) << std::setprecision(2) << speed / singleThreadSpeed << "\n";
+      }
+   }
+   checker.SetWorkerPool(nullptr);
+   return 0;
+}
@@ -0,0 +1,338 @@
+#include "Differential.h"
+#include "../Unicode.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+
+namespace differential
+{
+
+namespace
+{
+
+using Correction = WordSpellChecker::Correction;
+
+/// <summary>
+/// Letters test words are made of: 2 bytes and 3 bytes UTF-8 letters share prefixes with each other
+/// </summary>
+const char* const gc_letters[] = { "a", "b", "c", "d", "e", u8"é", u8"ê", u8"ж", u8"з" };
+
+/// <summary>
+/// Reads bytes of a fuzzer input, zeros when exhausted
+/// </summary>
+class ByteReader
+{
+public:
+   ByteReader(const uint8_t* data, size_t size)
+      : m_data(data)
+      , m_size(size)
+      , m_pos(0)
+   {
+   }
+
+   bool IsEmpty() const { return m_pos >= m_size; }
+
+   uint8_t Next() { return IsEmpty() ? 0 : m_data[m_pos++]; }
+
+private:
+   const uint8_t* m_data;
+   size_t m_size;
+   size_t m_pos;
+};
+
+std::string readWord(ByteReader& reader)
+{
+   std::string word;
+   const size_t length = reader.Next() % 7;
+   for (size_t i = 0; i < length; ++i)
+   {
+      word += gc_letters[reader.Next() % std::size(gc_letters)];
+   }
+   return word;
+}
+
+/// <summary>
+/// The reference: every mask compared letter by letter with every dictionary word, no trie
+/// </summary>
+class Reference
+{
+public:
+   explicit Reference(const StringVec& dictionary)
+   {
+      for (size_t i = 0; i < dictionary.size(); ++i)
+      {
+         auto letters = unicode::ToUtf32(dictionary[i]);
+         // as in the trie, words with other symbols than letters are not in the dictionary
+         const bool isValid = std::all_of(letters.begin(), letters.end(), [](char32_t letter) { return unicode::IsLetter(letter); });
+         if (isValid && m_ranks.emplace(dictionary[i], static_cast<trie::Rank>(i)).second)
+         {
+            m_words.emplace_back(dictionary[i], std::move(letters));
+         }
+      }
+   }
+
+   CheckResult Check(const std::string& word) const
+   {
+      if (m_ranks.count(word) != 0)
+      {
+         return { Correction::No, { word } };
+      }
+
+      const auto& alphabet = unicode::GetAlphabet(unicode::GetScript(word));
+      const auto [oneCorrectionMasks, twoCorrectionsMasks] = WordSpellChecker::CreateMasks(word);
+      auto candidates = findAll(oneCorrectionMasks, alphabet);
+      if (!candidates.empty())
+      {
+         return { Correction::One, candidates };
+      }
+      return { Correction::Two, findAll(twoCorrectionsMasks, alphabet) };
+   }
+
+   /// <summary>
+   /// The best ranked corrections of the reference result, words rank in the dictionary order
+   /// </summary>
+   CheckResult GetBest(const CheckResult& result, size_t maxCorrections) const
+   {
+      auto best = result;
+      std::sort(best.second.begin(), best.second.end(), [this](const std::string& left, const std::string& right)
+      {
+         return m_ranks.at(left) < m_ranks.at(right);
+      });
+      best.second.resize(std::min(best.second.size(), maxCorrections));
+      return best;
+   }
+
+private:
+   using Word = std::pair<std::string, std::u32string>;
+
+   static bool isInAlphabet(char32_t letter, const unicode::Alphabet& alphabet)
+   {
+      return std::any_of(alphabet.begin(), alphabet.end(), [letter](const unicode::CodePointRange& range)
+      {
+         return range.first <= letter && letter <= range.last;
+      });
+   }
+
+   /// <summary>
+   /// ? matches any letter of the alphabet, other mask letters only themselves
+   /// </summary>
+   static bool isMatch(const std::u32string& mask, const std::u32string& letters, const unicode::Alphabet& alphabet)
+   {
+      if (mask.size() != letters.size())
+      {
+         return false;
+      }
+      for (size_t pos = 0; pos < mask.size(); ++pos)
+      {
+         if (mask[pos] == U'?' ? !isInAlphabet(letters[pos], alphabet) : mask[pos] != letters[pos])
+         {
+            return false;
+         }
+      }
+      return true;
+   }
+
+   StringVec findAll(const WordSpellChecker::StringSet& masks, const unicode::Alphabet& alphabet) const
+   {
+      WordSpellChecker::StringSet candidates;
+      for (const auto& mask : masks)
+      {
+         const auto maskLetters = unicode::ToUtf32(mask);
+         for (const auto& [word, letters] : m_words)
+         {
+            if (isMatch(maskLetters, letters, alphabet))
+            {
+               candidates.insert(word);
+            }
+         }
+      }
+      return StringVec(candidates.begin(), candidates.end());
+   }
+
+   /// <summary>
+   /// Distinct dictionary words and their letters
+   /// </summary>
+   std::vector<Word> m_words;
+
+   /// <summary>
+   /// Rank of every word: the position of its first occurrence in the dictionary
+   /// </summary>
+   std::map<std::string, trie::Rank> m_ranks;
+};
+
+CheckResult toCheckResult(WordSpellChecker::SpellCheckingRes res)
+{
+   return { res.first, StringVec(res.second.begin(), res.second.end()) };
+}
+
+/// <summary>
+/// Words of a detailed result, a correction its edits don't make from the word is reported as a mismatching one
+/// </summary>
+CheckResult toCheckResult(const std::string& word, const WordSpellChecker::DetailedSpellCheckingRes& res)
+{
+   WordSpellChecker::StringSet words;
+   for (const auto& candidate : res.second)
+   {
+      std::string edited;
+      if (!WordSpellChecker::ApplyEdits(word, candidate.edits, edited))
+      {
+         edited = "invalid edits";
+      }
+      words.insert(edited == candidate.word ? edited : candidate.word + " != " + edited);
+   }
+   return { res.first, StringVec(words.begin(), words.end()) };
+}
+
+std::shared_ptr<WordSpellChecker> buildChecker(const StringVec& dictionary)
+{
+   auto checker = std::make_shared<WordSpellChecker>();
+   checker->AddWords(dictionary.begin(), dictionary.end());
+   return checker;
+}
+
+std::vector<Engine> createEngines()
+{
+   std::vector<Engine> engines;
+   engines.push_back({ "batch", 0, [](const StringVec& dictionary) -> CheckFn
+   {
+      auto checker = buildChecker(dictionary);
+      return [checker](const std::string& word) { return toCheckResult(checker->CheckSpelling(word)); };
+   } });
+
+   engines.push_back({ "word-by-word", 0, [](const StringVec& dictionary) -> CheckFn
+   {
+      auto checker = std::make_shared<WordSpellChecker>();
+      for (const auto& word : dictionary)
+      {
+         checker->AddWord(word);
+      }
+      return [checker](const std::string& word) { return toCheckResult(checker->CheckSpelling(word)); };
+   } });
+
+   engines.push_back({ "async", 0, [](const StringVec& dictionary) -> CheckFn
+   {
+      auto checker = buildChecker(dictionary);
+      return [checker](const std::string& word)
+      {
+         std::deque<std::function<void()>> tasks;
+         CheckResult result;
+         checker->CheckSpellingAsync(word, [&tasks](std::function<void()> task) { tasks.push_back(std::move(task)); },
+            [&result](WordSpellChecker::SpellCheckingRes res) { result = toCheckResult(std::move(res)); });
+         for (; !tasks.empty(); tasks.pop_front())
+         {
+            tasks.front()();
+         }
+         return result;
+      };
+   } });
+
+   engines.push_back({ "pool+replica", 0, [](const StringVec& dictionary) -> CheckFn
+   {
+      auto checker = buildChecker(dictionary);
+      checker->SetWorkerPool(std::make_shared<WorkerPool>(WorkerPool::Options{ 2, true }));
+      checker->ReplicateDictionary();
+      return [checker](const std::string& word) { return toCheckResult(checker->CheckSpelling(word)); };
+   } });
+
+   engines.push_back({ "profiled-layout", 0, [](const StringVec& dictionary) -> CheckFn
+   {
+      auto checker = buildChecker(dictionary);
+      trie::StringViewVec sampleWords;
+      for (size_t i = 0; i < dictionary.size(); i += 2)
+      {
+         sampleWords.push_back(dictionary[i]);
+      }
+      checker->OptimizeLayout(sampleWords);
+      return [checker](const std::string& word) { return toCheckResult(checker->CheckSpelling(word)); };
+   } });
+
+   engines.push_back({ "edit-scripts", 0, [](const StringVec& dictionary) -> CheckFn
+   {
+      auto checker = buildChecker(dictionary);
+      return [checker](const std::string& word) { return toCheckResult(word, checker->CheckSpellingDetailed(word)); };
+   } });
+
+   engines.push_back({ "best-3", 3, [](const StringVec& dictionary) -> CheckFn
+   {
+      auto checker = buildChecker(dictionary);
+      return [checker](const std::string& word) { return CheckResult(checker->CheckSpelling(word, 3)); };
+   } });
+
+   return engines;
+}
+
+double getSeconds(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+const std::vector<Engine>& GetEngines()
+{
+   static const std::vector<Engine> engines = createEngines();
+   return engines;
+}
+
+TestCase CreateTestCase(const uint8_t* data, size_t size)
+{
+   ByteReader reader(data, size);
+   TestCase testCase;
+   const size_t dictionarySize = reader.Next() % 48;
+   for (size_t i = 0; i < dictionarySize; ++i)
+   {
+      testCase.dictionary.push_back(readWord(reader));
+   }
+   do
+   {
+      testCase.words.push_back(readWord(reader));
+   } while (!reader.IsEmpty());
+   return testCase;
+}
+
+void Run(const TestCase& testCase, std::vector<EngineReport>& reports,
+   const std::function<void(const char*, const std::string&, const CheckResult&, const CheckResult&)>& onMismatch)
+{
+   const Reference reference(testCase.dictionary);
+   std::vector<CheckResult> expected;
+   const auto referenceStart = std::chrono::steady_clock::now();
+   for (const auto& word : testCase.words)
+   {
+      expected.push_back(reference.Check(word));
+   }
+   const double referenceSeconds = getSeconds(referenceStart);
+
+   const auto& engines = GetEngines();
+   reports.resize(engines.size());
+   for (size_t i = 0; i < engines.size(); ++i)
+   {
+      const auto& engine = engines[i];
+      auto& report = reports[i];
+      report.name = engine.name;
+      report.referenceSeconds += referenceSeconds;
+
+      const auto check = engine.build(testCase.dictionary);
+      const auto start = std::chrono::steady_clock::now();
+      std::vector<CheckResult> results;
+      for (const auto& word : testCase.words)
+      {
+         results.push_back(check(word));
+      }
+      report.seconds += getSeconds(start);
+
+      for (size_t j = 0; j < testCase.words.size(); ++j)
+      {
+         const auto expectedResult = engine.maxCorrections == 0 ? expected[j] :
+            reference.GetBest(expected[j], engine.maxCorrections);
+         if (results[j] != expectedResult)
+         {
+            ++report.mismatches;
+            onMismatch(engine.name, testCase.words[j], expectedResult, results[j]);
+         }
+      }
+   }
+}
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../WordSpellChecker.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Differential testing of correction engines against the reference: <c>WordSpellChecker::CreateMasks</c>
+/// masks compared letter by letter with every dictionary word, without a trie
+/// </summary>
+namespace differential
+{
+
+using StringVec = WordSpellChecker::StringVec;
+
+/// <summary>
+/// Correction and the corrected words, sorted alphabetically or by rank for the best ranked corrections
+/// </summary>
+using CheckResult = std::pair<WordSpellChecker::Correction, StringVec>;
+using CheckFn = std::function<CheckResult(const std::string&)>;
+
+/// <summary>
+/// A dictionary and words to check
+/// </summary>
+struct TestCase
+{
+   StringVec dictionary;
+   StringVec words;
+};
+
+/// <summary>
+/// A correction engine to compare with the reference
+/// </summary>
+struct Engine
+{
+   const char* name;
+
+   /// <summary>
+   /// Max number of corrections the engine returns, the best ranked; 0 for all
+   /// </summary>
+   size_t maxCorrections;
+
+   /// <summary>
+   /// Builds the engine for a dictionary, the check function keeps what it needs alive
+   /// </summary>
+   std::function<CheckFn(const StringVec& dictionary)> build;
+};
+
+struct EngineReport
+{
+   const char* name = nullptr;
+   size_t mismatches = 0;
+
+   /// <summary>
+   /// Check time of the engine and the reference
+   /// </summary>
+   double seconds = 0;
+   double referenceSeconds = 0;
+};
+
+/// <summary>
+/// Engines available in the tree
+/// </summary>
+const std::vector<Engine>& GetEngines();
+
+/// <summary>
+/// Creates a test case from arbitrary bytes, e.g. a fuzzer input: small dictionaries
+/// over a few Latin, accented and Cyrillic letters, so edits often hit dictionary words
+/// </summary>
+TestCase CreateTestCase(const uint8_t* data, size_t size);
+
+/// <summary>
+/// Checks the words of the test case with the reference and every engine
+/// </summary>
+/// <param name="testCase">dictionary and words</param>
+/// <param name="reports">updated with mismatches and times, one per engine</param>
+/// <param name="onMismatch">called for every mismatch with the engine name, the word and both results</param>
+void Run(const TestCase& testCase, std::vector<EngineReport>& reports,
+   const std::function<void(const char*, const std::string&, const CheckResult&, const CheckResult&)>& onMismatch);
+
+}
@@ -0,0 +1,96 @@
+#include "Differential.h"
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace
+{
+
+const size_t gc_defaultIterations = 1000;
+const size_t gc_maxInputSize = 256;
+
+void printResult(const differential::CheckResult& result)
+{
+   std::cout << static_cast<int>(result.first) << " {";
+   for (const auto& word : result.second)
+   {
+      std::cout << ' ' << word;
+   }
+   std::cout << " }";
+}
+
+void printMismatch(const char* engineName, const std::string& word,
+   const differential::CheckResult& expected, const differential::CheckResult& actual)
+{
+   std::cout << engineName << ": '" << word << "' expected ";
+   printResult(expected);
+   std::cout << ", got ";
+   printResult(actual);
+   std::cout << "\n";
+}
+
+}
+
+/// <summary>
+/// libFuzzer entry point: aborts on the first mismatch
+/// </summary>
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+   std::vector<differential::EngineReport> reports;
+   bool isMismatched = false;
+   differential::Run(differential::CreateTestCase(data, size), reports,
+      [&isMismatched](const char* engineName, const std::string& word,
+         const differential::CheckResult& expected, const differential::CheckResult& actual)
+   {
+      printMismatch(engineName, word, expected, actual);
+      isMismatched = true;
+   });
+   if (isMismatched)
+   {
+      std::abort();
+   }
+   return 0;
+}
+
+#ifndef SPELL_CHECKER_LIBFUZZER
+
+/// <summary>
+/// Deterministic mode: random inputs from the seed, prints mismatches and the speed of every engine
+/// relative to the reference
+/// differential [seed] [iterations]
+/// </summary>
+int main(int argc, char* argv[])
+{
+   const auto seed = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 1u;
+   const auto iterations = argc > 2 ? static_cast<size_t>(std::strtoul(argv[2], nullptr, 10)) : gc_defaultIterations;
+
+   std::mt19937 random(seed);
+   std::vector<differential::EngineReport> reports;
+   size_t wordCount = 0;
+   for (size_t i = 0; i < iterations; ++i)
+   {
+      std::vector<uint8_t> input(random() % gc_maxInputSize);
+      for (auto& byte : input)
+      {
+         byte = static_cast<uint8_t>(random());
+      }
+      const auto testCase = differential::CreateTestCase(input.data(), input.size());
+      wordCount += testCase.words.size();
+      differential::Run(testCase, reports, printMismatch);
+   }
+
+   std::cout << "Seed " << seed << ", " << iterations << " dictionaries, " << wordCount << " words\n";
+   std::cout << std::left << std::setw(16) << "engine" << std::right << std::setw(12) << "mismatches"
+      << std::setw(16) << "relative speed" << "\n";
+   size_t mismatches = 0;
+   for (const auto& report : reports)
+   {
+      mismatches += report.mismatches;
+      std::cout << std::left << std::setw(16) << report.name << std::right << std::setw(12) << report.mismatches
+         << std::setw(16) << std::fixed << std::setprecision(2) << report.referenceSeconds / report.seconds << "\n";
+   }
+   return mismatches == 0 ? 0 : 1;
+}
+
+#endif
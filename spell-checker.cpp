@@ -1,9 +1,10 @@
 #include "TextSpellChecker.h"
+#include "InputBuffer.h"
+#include <cstdlib>
 #include <iostream>
-#include <iterator>
 #include <fstream>
-#include <sstream>
 #include <string>
+#include <string_view>
 
 namespace
 {
@@ -18,8 +19,9 @@ const std::string delimiter = "===";
 
 }
 
-bool readDictionary(std::ifstream& inputFile, TextSpellChecker& checker, size_t& readLineNumber)
+bool readDictionary(LineReader& inputFile, TextSpellChecker& checker, size_t& readLineNumber)
 {
+   trie::StringViewVec dictionary;
    for (; ; ++readLineNumber)
    {
       if (readLineNumber > gc_maxLinesInFile)
@@ -27,39 +29,40 @@ bool readDictionary(std::ifstream& inputFile, TextSpellChecker& checker, size_t&
          std::cout << "Too large file, max " << gc_maxLinesInFile << " lines allowed\n";
          return false;
       }
-      std::string line;
-      std::getline(inputFile, line);
-      if (line == delimiter)
-      {
-         break;
-      }
-      if (!inputFile)
+      std::string_view line;
+      if (!inputFile.NextLine(line))
       {
          std::cout << "End of file reached while delimiter " << delimiter << " not read\n";
          return false;
       }
-      std::istringstream iss(line);
-      std::vector<std::string> dictionary;
-      std::copy(std::istream_iterator<std::string>(iss),
-         std::istream_iterator<std::string>(),
-         std::back_inserter(dictionary));
+      if (line == delimiter)
+      {
+         break;
+      }
 
-      for (const auto& word : dictionary)
+      const bool areWordsValid = ForEachWord(line, [&dictionary](std::string_view word)
       {
          if (word.size() > gc_maxWordLength)
          {
             std::cout << "Too long word: " << word << " , max " << gc_maxWordLength << " chars allowed\n";
             return false;
          }
-         checker.AddWordToDictionary(word);
+         dictionary.push_back(word);
+         return true;
+      });
+      if (!areWordsValid)
+      {
+         return false;
       }
    }
 
+   checker.AddWordToDictionary(dictionary.begin(), dictionary.end());
    return true;
 }
 
-bool readText(std::ifstream& inputFile, std::string& textToCheck, size_t& readLineNumber)
+bool readText(LineReader& inputFile, std::string_view input, std::string_view& textToCheck, size_t& readLineNumber)
 {
+   const size_t textStart = inputFile.GetPosition();
    for (; ; ++readLineNumber)
    {
       if (readLineNumber > gc_maxLinesInFile)
@@ -67,35 +70,45 @@ bool readText(std::ifstream& inputFile, std::string& textToCheck, size_t& readLi
          std::cout << "Too large file, max " << gc_maxLinesInFile << " lines allowed\n";
          return false;
       }
-      std::string line;
-      std::getline(inputFile, line);
-      if (line == delimiter)
-      {
-         break;
-      }
-      if (!inputFile)
+      const size_t lineStart = inputFile.GetPosition();
+      std::string_view line;
+      if (!inputFile.NextLine(line))
       {
          std::cout << "End of file reached while delimiter " << delimiter << " not read\n";
          return false;
       }
-      textToCheck += line;
-      textToCheck += '\n';
+      if (line == delimiter)
+      {
+         // text lines are checked in place, every line ends with '\n' as it is followed by the delimiter
+         textToCheck = input.substr(textStart, lineStart - textStart);
+         break;
+      }
    }
 
    return true;
 }
 
-bool processInputArgs(int argc, char* argv[],
-   std::ofstream& outputFile, TextSpellChecker& checker, std::string& textToCheck)
+bool processInputArgs(int argc, char* argv[], InputBuffer& input,
+   std::ofstream& outputFile, TextSpellChecker& checker, std::string_view& textToCheck)
 {
-   if (argc != 3)
+   if (argc != 3 && argc != 4)
    {
-      std::cout << "spell-checker <input> <output>\n";
+      std::cout << "spell-checker <input> <output> [max corrections per word]\n";
       return false;
    }
 
-   std::ifstream inputFile(argv[1]);
-   if (!inputFile.is_open())
+   if (argc == 4)
+   {
+      const int maxCorrections = std::atoi(argv[3]);
+      if (maxCorrections <= 0)
+      {
+         std::cout << argv[3] << " is not a valid number of corrections\n";
+         return false;
+      }
+      checker.SetMaxCorrections(static_cast<size_t>(maxCorrections));
+   }
+
+   if (!input.Open(argv[1]))
    {
       std::cout << argv[1] << " can't be opened\n";
       return false;
@@ -108,13 +121,14 @@ bool processInputArgs(int argc, char* argv[],
       return false;
    }
 
+   LineReader inputFile(input.GetData());
    size_t readLineNumber = 0;
    if (!readDictionary(inputFile, checker, readLineNumber))
    {
       return false;
    }
 
-   if (!readText(inputFile, textToCheck, readLineNumber))
+   if (!readText(inputFile, input.GetData(), textToCheck, readLineNumber))
    {
       return false;
    }
@@ -124,10 +138,11 @@ bool processInputArgs(int argc, char* argv[],
 
 int main(int argc, char* argv[])
 {
+   InputBuffer input;
    std::ofstream outputFile;
    TextSpellChecker checker;
-   std::string textToCheck;
-   if (!processInputArgs(argc, argv, outputFile, checker, textToCheck))
+   std::string_view textToCheck;
+   if (!processInputArgs(argc, argv, input, outputFile, checker, textToCheck))
    {
       return -1;
    }
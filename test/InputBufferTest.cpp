@@ -0,0 +1,58 @@
+#include "gtest/gtest.h"
+#include "../InputBuffer.h"
+#include <vector>
+
+namespace
+{
+
+TEST(InputBufferTest, Open)
+{
+   InputBuffer input;
+   EXPECT_FALSE(input.Open("data/not_existing.txt"));
+
+   ASSERT_TRUE(input.Open("data/01_assingment.in.txt"));
+   EXPECT_TRUE(input.IsMapped());
+   EXPECT_EQ("rain ", input.GetData().substr(0, 5));
+
+#ifndef _WIN32
+   // not a regular file, read without mapping
+   ASSERT_TRUE(input.Open("/dev/null"));
+   EXPECT_FALSE(input.IsMapped());
+   EXPECT_TRUE(input.GetData().empty());
+#endif
+}
+
+TEST(InputBufferTest, LineReader)
+{
+   LineReader reader("first line\n\nthird\r\nlast");
+   std::vector<std::string_view> lines;
+   std::string_view line;
+   while (reader.NextLine(line))
+   {
+      lines.push_back(line);
+   }
+   const std::vector<std::string_view> expected = { "first line", "", "third\r", "last" };
+   EXPECT_EQ(expected, lines);
+   EXPECT_EQ(23u, reader.GetPosition());
+}
+
+TEST(InputBufferTest, ForEachWord)
+{
+   std::vector<std::string_view> words;
+   EXPECT_TRUE(ForEachWord(" \tone  two\r\n", [&words](std::string_view word)
+   {
+      words.push_back(word);
+      return true;
+   }));
+   const std::vector<std::string_view> expected = { "one", "two" };
+   EXPECT_EQ(expected, words);
+
+   size_t wordCount = 0;
+   EXPECT_FALSE(ForEachWord("one two three", [&wordCount](std::string_view)
+   {
+      return ++wordCount < 2;
+   }));
+   EXPECT_EQ(2u, wordCount);
+}
+
+}
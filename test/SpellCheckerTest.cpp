@@ -1,8 +1,14 @@
 
 #include "../WordSpellChecker.h"
 #include "../TextSpellChecker.h"
+#include "../DictionaryReloader.h"
+#include "../CountingResource.h"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <deque>
+#include <future>
 #include <fstream>
+#include <thread>
 
 namespace
 {
@@ -11,6 +17,33 @@ using StringVec = WordSpellChecker::StringVec;
 using StringSet = WordSpellChecker::StringSet;
 using StringSetPair = WordSpellChecker::StringSetPair;
 
+/// <summary>
+/// Single-threaded executor: tasks are queued and run in order, like on an event loop
+/// </summary>
+class QueueExecutor
+{
+public:
+   WordSpellChecker::Executor GetExecutor()
+   {
+      return [this](std::function<void()> task) { m_tasks.push_back(std::move(task)); };
+   }
+
+   size_t Run()
+   {
+      size_t taskCount = 0;
+      for (; !m_tasks.empty(); ++taskCount)
+      {
+         auto task = std::move(m_tasks.front());
+         m_tasks.pop_front();
+         task();
+      }
+      return taskCount;
+   }
+
+private:
+   std::deque<std::function<void()>> m_tasks;
+};
+
 TEST(SpellCheckerTest, CreateMasks)
 {
    EXPECT_EQ(StringSetPair({ { "?" }, {} }), WordSpellChecker::CreateMasks(""));
@@ -31,6 +64,12 @@ TEST(SpellCheckerTest, CreateMasks)
       WordSpellChecker::CreateMasks("abc"));
 }
 
+TEST(SpellCheckerTest, CreateMasksUtf8)
+{
+   EXPECT_EQ(StringSetPair({ "", u8"?é", u8"é?" }, { u8"?é?", "?" }), WordSpellChecker::CreateMasks(u8"é"));
+   EXPECT_EQ(WordSpellChecker::CreateMasks("ab").second.size(), WordSpellChecker::CreateMasks(u8"жы").second.size());
+}
+
 TEST(SpellCheckerTest, CheckSpellingSimple)
 {
    using Result = WordSpellChecker::SpellCheckingRes;
@@ -90,6 +129,35 @@ TEST(SpellCheckerTest, 50kWords)
    WordSpellChecker checker;
    checker.AddWords(vocabulary.begin(), vocabulary.end());
    EXPECT_EQ(Result(WordSpellChecker::Correction::Two, { "vocabulary" }), checker.CheckSpelling("vocubulary"));
+
+   WordSpellChecker serialChecker;
+   for (const auto& word : vocabulary)
+   {
+      serialChecker.AddWord(word);
+   }
+   for (const auto& word : { "vocubulary", "teh", "wrod", "speling", "a", "zz" })
+   {
+      EXPECT_EQ(serialChecker.CheckSpelling(word), checker.CheckSpelling(word)) << word;
+   }
+}
+
+TEST(SpellCheckerTest, CheckSpellingTopK)
+{
+   using RankedResult = WordSpellChecker::RankedSpellCheckingRes;
+   WordSpellChecker checker;
+   checker.AddWords({ "rain", "spain",  "plain",  "plaint",  "pain",  "main",  "mainly",
+                      "the",  "in",  "on",  "fall",  "falls",  "his",  "was" });
+
+   EXPECT_EQ(RankedResult(WordSpellChecker::Correction::No, { "pain" }), checker.CheckSpelling("pain", 1));
+   EXPECT_EQ(RankedResult(WordSpellChecker::Correction::One, { "main", "mainly" }), checker.CheckSpelling("mainy", 5));
+   EXPECT_EQ(RankedResult(WordSpellChecker::Correction::One, { "rain", "pain" }), checker.CheckSpelling("ain", 2));
+   EXPECT_EQ(RankedResult(WordSpellChecker::Correction::Two, { }), checker.CheckSpelling("hints", 3));
+   // 0 for no limit
+   EXPECT_EQ(RankedResult(WordSpellChecker::Correction::One, { "rain", "pain", "main", "in" }), checker.CheckSpelling("ain", 0));
+
+   WordSpellChecker replacementChecker;
+   replacementChecker.AddWords({ "hello", "hallo", "cello" });
+   EXPECT_EQ(RankedResult(WordSpellChecker::Correction::Two, { "hello", "hallo" }), replacementChecker.CheckSpelling("hxllo", 0));
 }
 
 TEST(SpellCheckerTest, SimpleText)
@@ -108,6 +176,21 @@ TEST(SpellCheckerTest, CaseInsensitive)
    EXPECT_EQ("Know How {is?} to pArse", res);
 }
 
+TEST(SpellCheckerTest, MaxCorrectionsText)
+{
+   TextSpellChecker checker;
+   checker.AddWordToDictionary({ "rain", "spain",  "plain",  "plaint",  "pain",  "main",  "mainly" });
+   checker.SetMaxCorrections(2);
+   EXPECT_EQ("{rain pain} Main", checker.CheckText("ain Main"));
+}
+
+TEST(SpellCheckerTest, Utf8Text)
+{
+   TextSpellChecker checker;
+   checker.AddWordToDictionary({ u8"café", u8"crème", u8"brûlée", u8"ёлка", u8"ель" });
+   EXPECT_EQ(u8"Café — crème brûlée; Ёлка ель ёлка", checker.CheckText(u8"Café — crme brûlé; Ёлкаа ель елка"));
+}
+
 TEST(SpellCheckerTest, AssignmentSampleText)
 {
    TextSpellChecker checker;
@@ -117,4 +200,398 @@ TEST(SpellCheckerTest, AssignmentSampleText)
    EXPECT_EQ("the {rame?} in pain falls\n{main mainly} on the plain\nwas {hints?} plaint", res);
 }
 
-}
\ No newline at end of file
+TEST(SpellCheckerTest, CheckSpellingAsync)
+{
+   WordSpellChecker checker;
+   checker.AddWords({ "rain", "spain",  "plain",  "plaint",  "pain",  "main",  "mainly" });
+
+   QueueExecutor executor;
+   std::vector<WordSpellChecker::SpellCheckingRes> results;
+   const StringVec words = { "rain", "ain", "plainly", "mainlyy", "xyz" };
+   for (const auto& word : words)
+   {
+      checker.CheckSpellingAsync(word, executor.GetExecutor(), [&results](WordSpellChecker::SpellCheckingRes res)
+      {
+         results.push_back(std::move(res));
+      });
+   }
+   EXPECT_TRUE(results.empty());
+   EXPECT_LT(words.size() * 2, executor.Run()); // masks are checked in chunks
+
+   ASSERT_EQ(words.size(), results.size());
+   for (const auto& word : words)
+   {
+      EXPECT_NE(results.end(), std::find(results.begin(), results.end(), checker.CheckSpelling(word))) << word;
+   }
+
+   WordSpellChecker::RankedSpellCheckingRes rankedRes;
+   checker.CheckSpellingAsync("ain", 2, executor.GetExecutor(), [&rankedRes](WordSpellChecker::RankedSpellCheckingRes res)
+   {
+      rankedRes = std::move(res);
+   });
+   executor.Run();
+   EXPECT_EQ(checker.CheckSpelling("ain", 2), rankedRes);
+
+   // all the ranked corrections are matched in chunks too: a single pool thread runs them, waiting for none
+   auto pool = std::make_shared<WorkerPool>(WorkerPool::Options{ 1, false });
+   checker.SetWorkerPool(pool);
+   std::promise<WordSpellChecker::RankedSpellCheckingRes> allRankedRes;
+   checker.CheckSpellingAsync("mainy", 0, pool->GetExecutor(), [&allRankedRes](WordSpellChecker::RankedSpellCheckingRes res)
+   {
+      allRankedRes.set_value(std::move(res));
+   });
+   auto allRanked = allRankedRes.get_future();
+   ASSERT_EQ(std::future_status::ready, allRanked.wait_for(std::chrono::seconds(10)));
+   EXPECT_EQ(WordSpellChecker::RankedSpellCheckingRes(WordSpellChecker::Correction::One, { "main", "mainly" }), allRanked.get());
+}
+
+TEST(SpellCheckerTest, CheckTextAsync)
+{
+   TextSpellChecker checker;
+   checker.AddWordToDictionary({ "rain", "spain",  "plain",  "plaint",  "pain",  "main",  "mainly",
+                      "the",  "in",  "on",  "fall",  "falls",  "his",  "was" });
+
+   QueueExecutor executor;
+   const StringVec texts = { "hte rame in pain fells\nmainy oon teh lain\nwas hints pliant", "", "...", "Was" };
+   StringVec results(texts.size());
+   for (size_t i = 0; i < texts.size(); ++i)
+   {
+      checker.CheckTextAsync(texts[i], executor.GetExecutor(), [&results, i](std::string res)
+      {
+         results[i] = std::move(res);
+      });
+   }
+   executor.Run();
+
+   for (size_t i = 0; i < texts.size(); ++i)
+   {
+      EXPECT_EQ(checker.CheckText(texts[i]), results[i]);
+   }
+   EXPECT_EQ("the {rame?} in pain falls\n{main mainly} on the plain\nwas {hints?} plaint", results[0]);
+}
+
+TEST(SpellCheckerTest, ReplaceDictionary)
+{
+   TextSpellChecker checker;
+   checker.AddWordToDictionary({ "rain", "main" });
+
+   auto newWordChecker = std::make_shared<WordSpellChecker>();
+   newWordChecker->AddWords({ "pain", "plain" });
+
+   QueueExecutor executor;
+   std::string inFlightRes;
+   checker.CheckTextAsync("ain", executor.GetExecutor(), [&inFlightRes](std::string res) { inFlightRes = std::move(res); });
+
+   auto oldDictionary = checker.GetDictionary();
+   std::weak_ptr<const WordSpellChecker> oldWordChecker = checker.ReplaceDictionary(newWordChecker);
+   EXPECT_EQ(newWordChecker, checker.GetWordChecker());
+   EXPECT_EQ("pain", checker.CheckText("ain"));
+   EXPECT_TRUE(checker.GetDictionary()->Contains("plain"));
+
+   // the replaced dictionary stays valid while it's held
+   EXPECT_TRUE(oldDictionary->Contains("rain"));
+   oldDictionary.reset();
+
+   // the check started before the replacement finishes with the old dictionary, then it's freed
+   EXPECT_FALSE(oldWordChecker.expired());
+   executor.Run();
+   EXPECT_EQ("{main rain}", inFlightRes);
+   EXPECT_TRUE(oldWordChecker.expired());
+}
+
+TEST(SpellCheckerTest, DictionaryReloader)
+{
+   const auto path = testing::TempDir() + "reloaded_dictionary.txt";
+   std::ofstream(path) << "pain plain\nspain\n";
+
+   TextSpellChecker checker;
+   checker.AddWordToDictionary({ "rain", "main" });
+   DictionaryReloader reloader(checker);
+
+   DictionaryReloader::Report report;
+   EXPECT_TRUE(reloader.Reload(path, [&report](const DictionaryReloader::Report& res) { report = res; }));
+   reloader.Wait();
+   EXPECT_TRUE(report.isReloaded);
+   EXPECT_EQ(3u, report.wordCount);
+   EXPECT_EQ(checker.GetDictionary()->MemoryUsage(), report.dictionaryBytes);
+   EXPECT_LT(report.dictionaryBytes, report.peakBytes);
+   EXPECT_EQ("pain", checker.CheckText("ain"));
+
+   // a reload is refused while the replaced dictionary is in use
+   auto inUse = checker.GetWordChecker();
+   EXPECT_TRUE(reloader.Reload(path, [](const DictionaryReloader::Report&) {}));
+   reloader.Wait();
+   EXPECT_FALSE(reloader.Reload(path, [](const DictionaryReloader::Report&) {}));
+   inUse.reset();
+
+   // concurrent reloads don't overlap, one of them starts at least
+   for (size_t i = 0; i < 20; ++i)
+   {
+      const auto reload = [&reloader, &path]() { return reloader.Reload(path, [](const DictionaryReloader::Report&) {}); };
+      auto first = std::async(std::launch::async, reload);
+      auto second = std::async(std::launch::async, reload);
+      const bool isFirstStarted = first.get();
+      EXPECT_TRUE(second.get() || isFirstStarted);
+      reloader.Wait();
+   }
+
+   EXPECT_TRUE(reloader.Reload(path + ".missing", [&report](const DictionaryReloader::Report& res) { report = res; }));
+   reloader.Wait();
+   EXPECT_FALSE(report.isReloaded);
+   EXPECT_EQ("pain", checker.CheckText("ain"));
+   std::remove(path.c_str());
+}
+
+TEST(SpellCheckerTest, WorkerPool)
+{
+   TextSpellChecker checker;
+   checker.AddWordToDictionary({ "rain", "spain",  "plain",  "plaint",  "pain",  "main",  "mainly",
+                      "the",  "in",  "on",  "fall",  "falls",  "his",  "was" });
+   const std::string text = "hte rame in pain fells\nmainy oon teh lain\nwas hints pliant";
+   const auto expected = checker.CheckText(text);
+
+   auto pool = std::make_shared<WorkerPool>(WorkerPool::Options{ 2, true });
+   checker.SetWorkerPool(pool, true);
+   const auto wordChecker = checker.GetWordChecker();
+   EXPECT_TRUE(wordChecker->IsDictionaryReplicated());
+   EXPECT_LT(checker.GetDictionary()->MemoryUsage(), wordChecker->MemoryUsage());
+   EXPECT_EQ(expected, checker.CheckText(text));
+
+   std::promise<std::string> res;
+   checker.CheckTextAsync(text, pool->GetExecutor(), [&res](std::string output) { res.set_value(std::move(output)); });
+   EXPECT_EQ(expected, res.get_future().get());
+}
+
+TEST(SpellCheckerTest, WorkBudget)
+{
+   WorkBudget text(10, std::chrono::hours(1));
+   WorkBudget word(8, WorkBudget::Clock::duration::zero(), &text);
+   EXPECT_TRUE(word.Spend(6));
+   EXPECT_FALSE(word.Spend(3));
+   EXPECT_TRUE(word.Spend(2));
+   word.ForceSpend(5);
+   EXPECT_EQ(13u, word.GetSpentMasks());
+   EXPECT_EQ(13u, text.GetSpentMasks());
+
+   WorkBudget nextWord(8, WorkBudget::Clock::duration::zero(), &text);
+   EXPECT_FALSE(nextWord.Spend(1)); // the text is over its limit
+   nextWord.OnDegraded();
+   EXPECT_EQ(1u, nextWord.GetDegradedCount());
+   EXPECT_EQ(1u, text.GetDegradedCount());
+   EXPECT_FALSE(nextWord.IsExpired());
+
+   WorkBudget unlimited;
+   EXPECT_TRUE(unlimited.Spend(1000000));
+   EXPECT_FALSE(unlimited.IsExpired());
+
+   WorkBudget timed(0, std::chrono::microseconds(1));
+   EXPECT_FALSE(timed.IsExpired()); // the time runs from the first spending
+   EXPECT_TRUE(timed.Spend(1));
+   std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   EXPECT_TRUE(timed.IsExpired());
+   EXPECT_FALSE(timed.Spend(1));
+}
+
+TEST(SpellCheckerTest, CheckSpellingWithinBudget)
+{
+   WordSpellChecker checker;
+   checker.AddWords({ "rain", "spain",  "plain",  "plaint",  "pain",  "main",  "mainly" });
+   const auto& [oneCorrectionMask, twoCorrectionsMask] = WordSpellChecker::CreateMasks("pliant");
+
+   WorkBudget fitting(oneCorrectionMask.size() + twoCorrectionsMask.size(), WorkBudget::Clock::duration::zero());
+   EXPECT_EQ(checker.CheckSpelling("pliant"), checker.CheckSpelling("pliant", fitting));
+   EXPECT_EQ(0u, fitting.GetDegradedCount());
+
+   // one correction masks are always matched
+   WorkBudget small(1, WorkBudget::Clock::duration::zero());
+   EXPECT_EQ(Result(WordSpellChecker::Correction::One, { "main", "mainly" }), checker.CheckSpelling("mainy", small));
+   EXPECT_EQ(Result(WordSpellChecker::Correction::No, { "plain" }), checker.CheckSpelling("plain", small));
+   EXPECT_EQ(0u, small.GetDegradedCount());
+   EXPECT_EQ(Result(WordSpellChecker::Correction::Two, { }), checker.CheckSpelling("pliant", small));
+   EXPECT_EQ(1u, small.GetDegradedCount());
+   EXPECT_EQ(WordSpellChecker::RankedSpellCheckingRes(WordSpellChecker::Correction::Two, { }), checker.CheckSpelling("pliant", 2, small));
+   EXPECT_EQ(2u, small.GetDegradedCount());
+
+   WorkBudget expired(0, std::chrono::microseconds(1));
+   expired.ForceSpend(0);
+   std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   EXPECT_EQ(Result(WordSpellChecker::Correction::Two, { }), checker.CheckSpelling("pliant", expired));
+   EXPECT_EQ(1u, expired.GetDegradedCount());
+   // the one correction mask chunks started after the time is out are skipped too
+   EXPECT_EQ(Result(WordSpellChecker::Correction::Two, { }), checker.CheckSpelling("mainy", expired));
+   EXPECT_EQ(2u, expired.GetDegradedCount());
+   EXPECT_EQ(WordSpellChecker::RankedSpellCheckingRes(WordSpellChecker::Correction::Two, { }), checker.CheckSpelling("mainy", 2, expired));
+   EXPECT_EQ(3u, expired.GetDegradedCount());
+   EXPECT_EQ(WordSpellChecker::RankedSpellCheckingRes(WordSpellChecker::Correction::Two, { }), checker.CheckSpelling("mainy", 0, expired));
+   EXPECT_EQ(4u, expired.GetDegradedCount());
+
+   QueueExecutor executor;
+   auto asyncBudget = std::make_shared<WorkBudget>(1, WorkBudget::Clock::duration::zero());
+   Result asyncRes;
+   checker.CheckSpellingAsync("pliant", executor.GetExecutor(), [&asyncRes](Result res) { asyncRes = std::move(res); }, asyncBudget);
+   executor.Run();
+   EXPECT_EQ(Result(WordSpellChecker::Correction::Two, { }), asyncRes);
+   EXPECT_EQ(1u, asyncBudget->GetDegradedCount());
+}
+
+TEST(SpellCheckerTest, WorkLimitsText)
+{
+   TextSpellChecker checker;
+   checker.AddWordToDictionary({ "rain", "spain",  "plain",  "plaint",  "pain",  "main",  "mainly",
+                      "the",  "in",  "on",  "fall",  "falls",  "his",  "was" });
+   const std::string text = "hte rame in pain fells\nmainy oon teh lain\nwas hints pliant";
+   const std::string degradedText = "{hte?} {rame?} in pain {fells?}\n{main mainly} on {teh?} plain\nwas {hints?} {pliant?}";
+
+   size_t degradedWordCount = 0;
+   EXPECT_EQ("the {rame?} in pain falls\n{main mainly} on the plain\nwas {hints?} plaint", checker.CheckText(text, degradedWordCount));
+   EXPECT_EQ(0u, degradedWordCount);
+
+   TextSpellChecker::WorkLimits wordLimits;
+   wordLimits.maxWordMasks = 10;
+   checker.SetWorkLimits(wordLimits);
+   EXPECT_EQ(degradedText, checker.CheckText(text, degradedWordCount));
+   EXPECT_EQ(6u, degradedWordCount);
+
+   TextSpellChecker::WorkLimits textLimits;
+   textLimits.maxTextMasks = 1;
+   checker.SetWorkLimits(textLimits);
+   EXPECT_EQ(degradedText, checker.CheckText(text, degradedWordCount));
+   EXPECT_EQ(6u, degradedWordCount);
+   EXPECT_EQ(12u, checker.GetDegradedWordCount());
+
+   QueueExecutor executor;
+   std::string asyncRes;
+   checker.CheckTextAsync(text, executor.GetExecutor(), [&asyncRes](std::string res) { asyncRes = std::move(res); });
+   executor.Run();
+   EXPECT_EQ(degradedText, asyncRes);
+   EXPECT_EQ(18u, checker.GetDegradedWordCount());
+}
+
+TEST(SpellCheckerTest, MemoryResources)
+{
+   CountingResource dictionary;
+   CountingResource scratch;
+   const std::string text = "hte rame in pain fells\nmainy oon teh lain\nwas hints pliant";
+   {
+      TextSpellChecker checker(&dictionary, &scratch);
+      checker.AddWordToDictionary({ "rain", "spain",  "plain",  "plaint",  "pain",  "main",  "mainly",
+                         "the",  "in",  "on",  "fall",  "falls",  "his",  "was" });
+      EXPECT_EQ(checker.GetDictionary()->MemoryUsage() - sizeof(trie::Trie), dictionary.GetBytesInUse());
+      EXPECT_EQ(0u, scratch.GetAllocationCount());
+
+      EXPECT_EQ("the {rame?} in pain falls\n{main mainly} on the plain\nwas {hints?} plaint", checker.CheckText(text));
+      EXPECT_EQ(0u, scratch.GetBytesInUse());
+      // the masks of the words fit the scratch buffer, it's the only allocation of a text
+      EXPECT_EQ(1u, scratch.GetAllocationCount());
+      checker.SetMaxCorrections(1);
+      EXPECT_EQ("the {rame?} in pain falls\nmain on the plain\nwas {hints?} plaint", checker.CheckText(text));
+      EXPECT_EQ(2u, scratch.GetAllocationCount());
+
+      // the copies of the dictionary are allocated from its resource
+      auto pool = std::make_shared<WorkerPool>(WorkerPool::Options{ 2, true });
+      checker.SetWorkerPool(pool, true);
+      EXPECT_EQ(checker.GetWordChecker()->MemoryUsage() - sizeof(trie::Trie) * (1 + pool->GetNodeCount()), dictionary.GetBytesInUse());
+   }
+   EXPECT_EQ(0u, dictionary.GetBytesInUse());
+
+   WordSpellChecker checker;
+   checker.AddWords({ "pneumonoultramicroscopicsilicovolcanoconiosis" });
+   std::pmr::monotonic_buffer_resource buffer(&scratch);
+   WorkBudget budget;
+   EXPECT_EQ(checker.CheckSpelling("pneumonoultramicroscopicsilicovolcanoconiosiss"),
+      checker.CheckSpelling("pneumonoultramicroscopicsilicovolcanoconiosiss", budget, &buffer));
+   EXPECT_LT(0u, scratch.GetBytesInUse());
+   buffer.release();
+   EXPECT_EQ(0u, scratch.GetBytesInUse());
+}
+
+TEST(SpellCheckerTest, CheckSpellingDetailed)
+{
+   using Edit = WordSpellChecker::Edit;
+   WordSpellChecker checker;
+   checker.AddWords({ "rain", "spain",  "plain",  "plaint",  "pain",  "main",  "mainly", "the", u8"мир", u8"мирный" });
+
+   auto result = checker.CheckSpellingDetailed("plain");
+   EXPECT_EQ(WordSpellChecker::Correction::No, result.first);
+   ASSERT_EQ(1u, result.second.size());
+   EXPECT_EQ("plain", result.second[0].word);
+   EXPECT_EQ(0u, result.second[0].edits.count);
+   EXPECT_EQ(2u, result.second[0].score);
+
+   // sorted by the rank of the word: "main" is added before "mainly"
+   result = checker.CheckSpellingDetailed("mainy");
+   EXPECT_EQ(WordSpellChecker::Correction::One, result.first);
+   ASSERT_EQ(2u, result.second.size());
+   EXPECT_EQ("main", result.second[0].word);
+   EXPECT_EQ(5u, result.second[0].score);
+   ASSERT_EQ(1u, result.second[0].edits.count);
+   EXPECT_EQ(Edit::Type::Deletion, result.second[0].edits.edits[0].type);
+   EXPECT_EQ(4u, result.second[0].edits.edits[0].position);
+   EXPECT_EQ(U'y', result.second[0].edits.edits[0].letter);
+   EXPECT_EQ("mainly", result.second[1].word);
+   EXPECT_EQ(6u, result.second[1].score);
+   ASSERT_EQ(1u, result.second[1].edits.count);
+   EXPECT_EQ(Edit::Type::Insertion, result.second[1].edits.edits[0].type);
+   EXPECT_EQ(4u, result.second[1].edits.edits[0].position);
+   EXPECT_EQ(U'l', result.second[1].edits.edits[0].letter);
+
+   // a transposition is an insertion and a deletion, the insertion goes first
+   result = checker.CheckSpellingDetailed("pliant");
+   EXPECT_EQ(WordSpellChecker::Correction::Two, result.first);
+   ASSERT_EQ(1u, result.second.size());
+   EXPECT_EQ("plaint", result.second[0].word);
+   ASSERT_EQ(2u, result.second[0].edits.count);
+   EXPECT_EQ(Edit::Type::Insertion, result.second[0].edits.edits[0].type);
+   EXPECT_EQ(Edit::Type::Deletion, result.second[0].edits.edits[1].type);
+   EXPECT_LE(result.second[0].edits.edits[0].position, result.second[0].edits.edits[1].position);
+
+   // edits count letters, not bytes
+   result = checker.CheckSpellingDetailed(u8"мирныи");
+   EXPECT_EQ(WordSpellChecker::Correction::Two, result.first);
+   ASSERT_EQ(1u, result.second.size());
+   EXPECT_EQ(u8"мирный", result.second[0].word);
+   EXPECT_EQ(5u, result.second[0].edits.edits[0].position);
+
+   // the edits turn the word into every correction of the plain check
+   for (const std::string word : { "hte", "rame", "fells", "oon", "teh", "lain", "hints", "pliant", "mainy", "spian", "ranis",
+      u8"мр", u8"ммир", u8"мирнй" })
+   {
+      const auto expected = checker.CheckSpelling(word);
+      result = checker.CheckSpellingDetailed(word);
+      EXPECT_EQ(expected.first, result.first) << word;
+      StringSet words;
+      for (const auto& candidate : result.second)
+      {
+         words.insert(candidate.word);
+         std::string edited;
+         EXPECT_TRUE(WordSpellChecker::ApplyEdits(word, candidate.edits, edited)) << word;
+         EXPECT_EQ(candidate.word, edited) << word;
+         EXPECT_EQ(static_cast<size_t>(result.first), static_cast<size_t>(candidate.edits.count)) << word;
+      }
+      EXPECT_EQ(expected.second, words) << word;
+      EXPECT_TRUE(std::is_sorted(result.second.begin(), result.second.end(),
+         [](const auto& left, const auto& right) { return left.score < right.score; })) << word;
+   }
+
+   // the result within a budget matches, the masks are allocated from the scratch resource
+   CountingResource scratch;
+   WorkBudget budget;
+   result = checker.CheckSpellingDetailed("spian", budget, &scratch);
+   ASSERT_EQ(1u, result.second.size());
+   EXPECT_EQ("spain", result.second[0].word);
+   EXPECT_LT(0u, scratch.GetAllocationCount());
+   EXPECT_EQ(0u, scratch.GetBytesInUse());
+
+   // edits replay on the checked word only
+   WordSpellChecker::EditScript deletion;
+   deletion.edits[0] = { U'a', 1, Edit::Type::Deletion };
+   deletion.count = 1;
+   std::string edited;
+   EXPECT_TRUE(WordSpellChecker::ApplyEdits("main", deletion, edited));
+   EXPECT_EQ("min", edited);
+   EXPECT_FALSE(WordSpellChecker::ApplyEdits("mxin", deletion, edited));
+   deletion.edits[0].position = 4;
+   EXPECT_FALSE(WordSpellChecker::ApplyEdits("main", deletion, edited));
+}
+
+}
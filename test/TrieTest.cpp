@@ -1,6 +1,7 @@
 
 #include "gtest/gtest.h"
 #include "../Trie.h"
+#include "../CountingResource.h"
 
 namespace
 {
@@ -47,4 +48,294 @@ TEST(TrieTest, FindAllWithStar)
    EXPECT_EQ(StringVec({ "sample", "sanple" }), trie.FindAll("sa?ple"));
 }
 
-}
\ No newline at end of file
+TEST(TrieTest, AddAll)
+{
+   const StringVec words{ "war", "was", "arc", "ark", "arm", "army", "a", "", "was", "zoo", "zoom", "b" };
+
+   trie::Trie bulkTrie;
+   bulkTrie.Add("arms");
+   bulkTrie.AddAll(words);
+
+   trie::Trie trie;
+   trie.Add("arms");
+   for (const auto& word : words)
+   {
+      trie.Add(word);
+   }
+
+   for (const auto& mask : { "", "?", "a", "ar?", "ar??", "?r?", "wa?", "zoo?", "??", "?oo?", "arms" })
+   {
+      EXPECT_EQ(trie.FindAll(mask), bulkTrie.FindAll(mask)) << mask;
+   }
+   EXPECT_EQ(StringVec({ "arc", "ark", "arm" }), bulkTrie.FindAll("ar?"));
+   EXPECT_EQ(StringVec({ "arms", "army" }), bulkTrie.FindAll("ar??"));
+
+   // enough words for the sorted parallel build: all words of a few letters, longer ones first
+   StringVec manyWords{ "" };
+   for (size_t i = 0; manyWords.size() <= trie::Trie::sc_minSortedBuildWords; ++i)
+   {
+      for (const char letter : { 'b', 'a', 'c', 'd' })
+      {
+         manyWords.push_back(manyWords[i] + letter);
+      }
+   }
+   std::reverse(manyWords.begin(), manyWords.end());
+   trie::Trie manyBulkTrie;
+   manyBulkTrie.Add("abba");
+   manyBulkTrie.AddAll(manyWords);
+   trie::Trie manyTrie;
+   manyTrie.Add("abba");
+   for (const auto& word : manyWords)
+   {
+      manyTrie.Add(word);
+   }
+   for (const auto& mask : { "", "?", "a", "ab?", "?b??", "d?c?a", "??????" })
+   {
+      EXPECT_EQ(manyTrie.FindAll(mask), manyBulkTrie.FindAll(mask)) << mask;
+   }
+   trie::BestWords best(3);
+   manyBulkTrie.FindBest("ab??", best);
+   trie::BestWords expectedBest(3);
+   manyTrie.FindBest("ab??", expectedBest);
+   EXPECT_EQ(expectedBest.Take(), best.Take());
+}
+
+TEST(TrieTest, FindBest)
+{
+   trie::Trie trie;
+   trie.AddAll({ "war", "was", "arc", "ark", "arm", "army" });
+   trie.Add("wax", 100);
+   trie.Add("wan", 1);
+
+   trie::BestWords best(2);
+   trie.FindBest("wa?", best);
+   EXPECT_EQ(trie::RankedWordVec({ { 0, "war" }, { 1, "wan" } }), best.Take());
+
+   trie::BestWords bestOfMany(3);
+   trie.FindBest("ar?", bestOfMany);
+   trie.FindBest("?r?", bestOfMany);
+   trie.FindBest("wa?", bestOfMany);
+   EXPECT_EQ(trie::RankedWordVec({ { 0, "war" }, { 1, "wan" }, { 1, "was" } }), bestOfMany.Take());
+}
+
+TEST(TrieTest, WordCountAndMemoryUsage)
+{
+   trie::Trie trie;
+   EXPECT_EQ(0u, trie.GetWordCount());
+   const auto emptyTrieUsage = trie.MemoryUsage();
+
+   trie.AddAll({ "war", "was", "arc", "ark", "arm", "army", "arc" });
+   trie.Add("wars");
+   trie.Add("war");
+   trie.Add("Wars");
+   trie.Add("war's");
+   EXPECT_EQ(8u, trie.GetWordCount());
+   EXPECT_LT(emptyTrieUsage, trie.MemoryUsage());
+   EXPECT_EQ(StringVec{ "Wars" }, trie.FindAll("Wars"));
+   EXPECT_EQ(StringVec{ }, trie.FindAll("war's"));
+   EXPECT_EQ(StringVec({ "arc", "ark", "arm" }), trie.FindAll("ar?"));
+}
+
+TEST(TrieTest, Utf8)
+{
+   trie::Trie trie;
+   trie.AddAll({ u8"café", "cafe", u8"кафе", u8"naïve", "naive", u8"cafés" });
+
+   EXPECT_EQ(StringVec{ u8"кафе" }, trie.FindAll(u8"кафе"));
+   EXPECT_EQ(StringVec({ "cafe", u8"café" }), trie.FindAll("caf?"));
+   EXPECT_EQ(StringVec({ "naive", u8"naïve" }), trie.FindAll("na?ve"));
+   EXPECT_EQ(StringVec{ u8"кафе" }, trie.FindAll(u8"ка?е"));
+   EXPECT_EQ(StringVec({ "cafe", u8"café", u8"кафе" }), trie.FindAll("????"));
+   EXPECT_EQ(StringVec({ "cafe", u8"café" }), trie.FindAll("????", unicode::Script::Latin));
+   EXPECT_EQ(StringVec{ u8"кафе" }, trie.FindAll("????", unicode::Script::Cyrillic));
+   EXPECT_EQ(StringVec{ }, trie.FindAll("????", unicode::Script::Greek));
+}
+
+TEST(TrieTest, FindAllMasks)
+{
+   trie::Trie trie;
+   trie.AddAll({ "war", "was", "arc", "ark", "arm", "army", "wan" });
+   trie.Add(u8"wаs"); // Cyrillic а
+
+   const trie::StringViewVec masks = { "?r?", "ar?", "arm?", "w?s", "wa", "wa?", u8"wа?" };
+   trie::SearchStats oneByOneStats;
+   StringVec oneByOne;
+   for (const auto mask : masks)
+   {
+      const auto found = trie.FindAll(std::string(mask), unicode::Script::Any, &oneByOneStats);
+      oneByOne.insert(oneByOne.end(), found.begin(), found.end());
+   }
+   std::sort(oneByOne.begin(), oneByOne.end());
+   oneByOne.erase(std::unique(oneByOne.begin(), oneByOne.end()), oneByOne.end());
+
+   trie::SearchStats stats;
+   EXPECT_EQ(oneByOne, trie.FindAll(masks, unicode::Script::Any, &stats));
+   EXPECT_EQ(StringVec({ "arc", "ark", "arm", "army", "wan", "war", "was", u8"wаs" }), oneByOne);
+   EXPECT_LT(stats.visitedNodes, oneByOneStats.visitedNodes);
+
+   // ? stands for Latin letters only, letters of the masks are matched anyway
+   EXPECT_EQ(StringVec({ "was", u8"wаs" }), trie.FindAll(trie::StringViewVec{ "w?s", u8"wа?" }, unicode::Script::Latin));
+   EXPECT_EQ(StringVec{ }, trie.FindAll(trie::StringViewVec{ "w??", "?" }, unicode::Script::Cyrillic));
+   EXPECT_EQ(StringVec{ }, trie.FindAll(trie::StringViewVec{ }));
+
+   trie::BestWords best(2);
+   trie.FindBest(masks, best);
+   EXPECT_EQ(trie::RankedWordVec({ { 0, "war" }, { 1, "was" } }), best.Take());
+}
+
+TEST(TrieTest, OptimizeLayout)
+{
+   trie::Trie trie;
+   trie.AddAll({ "war", "was", "arc", "ark", "arm", "army", "wan", "a", "b", "c", "d", "e", "f", "g", "h", "i", "j" });
+   trie.Add(u8"wаs"); // Cyrillic а
+   EXPECT_TRUE(trie.Contains("arm"));
+   EXPECT_FALSE(trie.Contains("ar"));
+   EXPECT_FALSE(trie.Contains("ar?"));
+
+   const trie::StringViewVec masks = { "?r?", "ar?", "arm?", "w?s", "wa?", "?" };
+   const auto wordCount = trie.GetWordCount();
+   const auto found = trie.FindAll(masks);
+   trie::BestWords best(3);
+   trie.FindBest(masks, best);
+   const auto bestWords = best.Take();
+
+   trie.OptimizeLayout({ "army", "army", "arm", "was", "j", "unknown" });
+   EXPECT_EQ(wordCount, trie.GetWordCount());
+   EXPECT_EQ(found, trie.FindAll(masks));
+   trie.FindBest(masks, best);
+   EXPECT_EQ(bestWords, best.Take());
+   EXPECT_TRUE(trie.Contains("army"));
+   EXPECT_TRUE(trie.Contains(u8"wаs"));
+   EXPECT_FALSE(trie.Contains("ar"));
+
+   trie.OptimizeLayout({ });
+   trie.Add("arms");
+   trie.Add("k");
+   EXPECT_EQ(wordCount + 2, trie.GetWordCount());
+   EXPECT_EQ(StringVec({ "arms", "army" }), trie.FindAll("arm?"));
+   EXPECT_TRUE(trie.Contains("k"));
+}
+
+TEST(TrieTest, WordLengths)
+{
+   const std::string longWord = "pneumonoultramicroscopicsilicovolcanoconiosis";
+   const std::vector<std::string> words = { "bird", "word", "wordy", "birds", "birdsong", "wo", u8"ёрд", u8"ёрда", longWord,
+      longWord.substr(0, 31), longWord.substr(0, 32) };
+   trie::Trie wordByWord;
+   for (const auto& word : words)
+   {
+      wordByWord.Add(word);
+   }
+   trie::Trie bulk;
+   bulk.AddAll(trie::StringViewVec(words.begin(), words.end()));
+
+   // every letter of a word is replaced by ? in turn, a mask matches the words of its length only
+   for (const auto& word : words)
+   {
+      const auto letters = unicode::ToUtf32(word);
+      for (size_t i = 0; i < letters.size(); ++i)
+      {
+         auto maskLetters = letters;
+         maskLetters[i] = trie::Trie::sc_anyLetter;
+         const auto mask = unicode::ToUtf8(maskLetters);
+         StringVec expected;
+         for (const auto& other : words)
+         {
+            auto otherLetters = unicode::ToUtf32(other);
+            if (otherLetters.size() == letters.size())
+            {
+               otherLetters[i] = trie::Trie::sc_anyLetter;
+               if (otherLetters == maskLetters)
+               {
+                  expected.push_back(other);
+               }
+            }
+         }
+         std::sort(expected.begin(), expected.end());
+         EXPECT_EQ(expected, wordByWord.FindAll(mask)) << mask;
+         EXPECT_EQ(expected, bulk.FindAll(mask)) << mask;
+      }
+   }
+
+   // subtrees without 4 letter words are not entered
+   trie::SearchStats stats;
+   EXPECT_EQ(StringVec({ "bird", "word" }), bulk.FindAll("??rd", unicode::Script::Any, &stats));
+   EXPECT_EQ(11u, stats.visitedNodes);
+   EXPECT_EQ(StringVec{ }, bulk.FindAll("wor", unicode::Script::Any, &stats));
+   EXPECT_EQ(StringVec{ "wo" }, bulk.FindAll(trie::StringViewVec{ "w?", "wor", "??r" }));
+}
+
+TEST(TrieTest, WordIds)
+{
+   const std::vector<std::string> words = { "war", "was", "arc", "ark", "arm", "army", "a", "bird", "birds", "cat", "dog",
+      "egg", "fig", "gnu", u8"ёрд", u8"ёж", u8"мир" };
+   trie::Trie wordByWord;
+   for (const auto& word : words)
+   {
+      wordByWord.Add(word);
+   }
+   trie::Trie bulk;
+   bulk.AddAll(trie::StringViewVec(words.begin(), words.end()));
+   auto optimized = bulk.Clone();
+   optimized.OptimizeLayout({ "army", "birds", u8"ёж" });
+
+   const trie::StringViewVec masks = { "?", "a??", "ar?", "ar??", "bird?", "wa?", "?og", u8"ё?", u8"ёр?", u8"?и?" };
+   const auto expected = bulk.FindAll(masks);
+   for (const auto* trie : { &wordByWord, &bulk, &optimized })
+   {
+      const auto matches = trie->FindAllMatches(masks);
+      const auto isBefore = [](const trie::WordMatch& left, const trie::WordMatch& right) { return left.word < right.word; };
+      const auto isSame = [](const trie::WordMatch& left, const trie::WordMatch& right) { return left.word == right.word; };
+      EXPECT_TRUE(std::is_sorted(matches.begin(), matches.end(), isBefore));
+      EXPECT_EQ(matches.end(), std::adjacent_find(matches.begin(), matches.end(), isSame));
+
+      StringVec found;
+      for (const auto& match : matches)
+      {
+         const auto word = trie->GetWord(match.word);
+         ASSERT_LT(match.mask, masks.size());
+         const auto maskWords = trie->FindAll({ masks[match.mask] });
+         EXPECT_TRUE(std::binary_search(maskWords.begin(), maskWords.end(), word)) << word;
+         found.push_back(word);
+      }
+      std::sort(found.begin(), found.end());
+      EXPECT_EQ(expected, found);
+   }
+
+   // a copy keeps the ids
+   const auto copy = optimized.Clone();
+   const auto toWordIds = [&masks](const trie::Trie& trie)
+   {
+      std::vector<trie::WordId> wordIds;
+      for (const auto& match : trie.FindAllMatches(masks))
+      {
+         wordIds.push_back(match.word);
+      }
+      return wordIds;
+   };
+   EXPECT_EQ(toWordIds(optimized), toWordIds(copy));
+   EXPECT_TRUE(bulk.FindAllMatches({ "wo?" }).empty());
+}
+
+TEST(TrieTest, MemoryResource)
+{
+   CountingResource resource;
+   {
+      trie::Trie trie(&resource);
+      EXPECT_EQ(&resource, trie.GetMemoryResource());
+      trie.AddAll({ "war", "was", "arc", "ark", "arm", "army", "a", "b", "c", "d", "e", "f", "g", "h", "i", "j" });
+      trie.Add("wars");
+      trie.OptimizeLayout({ "army", "was" });
+      // every node and child list is allocated from the resource
+      EXPECT_EQ(trie.MemoryUsage() - sizeof(trie), resource.GetBytesInUse());
+
+      const auto copy = trie.Clone();
+      EXPECT_EQ(&resource, copy.GetMemoryResource());
+      EXPECT_EQ(trie.FindAll("ar?"), copy.FindAll("ar?"));
+      EXPECT_EQ(trie.MemoryUsage() + copy.MemoryUsage() - 2 * sizeof(trie), resource.GetBytesInUse());
+   }
+   EXPECT_EQ(0u, resource.GetBytesInUse());
+   EXPECT_LT(0u, resource.GetPeakBytes());
+}
+
+}
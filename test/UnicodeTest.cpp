@@ -0,0 +1,75 @@
+#include "gtest/gtest.h"
+#include "../Unicode.h"
+
+namespace
+{
+
+TEST(UnicodeTest, DecodeAndAppend)
+{
+   const std::string text = u8"aé€😀";
+   size_t pos = 0;
+   EXPECT_EQ(U'a', unicode::Decode(text, pos));
+   EXPECT_EQ(1u, pos);
+   EXPECT_EQ(U'é', unicode::Decode(text, pos));
+   EXPECT_EQ(3u, pos);
+   EXPECT_EQ(U'€', unicode::Decode(text, pos));
+   EXPECT_EQ(6u, pos);
+   EXPECT_EQ(U'😀', unicode::Decode(text, pos));
+   EXPECT_EQ(text.size(), pos);
+
+   std::string encoded;
+   for (const auto codePoint : { U'a', U'é', U'€', U'😀' })
+   {
+      unicode::Append(encoded, codePoint);
+   }
+   EXPECT_EQ(text, encoded);
+   EXPECT_EQ(text, unicode::ToUtf8(unicode::ToUtf32(text)));
+}
+
+TEST(UnicodeTest, DecodeMalformed)
+{
+   for (const std::string text : { "\x80", "\xC3", "\xC3\x28", "\xC0\xAF", "\xED\xA0\x80", "\xFF" })
+   {
+      size_t pos = 0;
+      EXPECT_EQ(unicode::gc_invalidCodePoint, unicode::Decode(text, pos));
+      EXPECT_EQ(1u, pos);
+   }
+}
+
+TEST(UnicodeTest, Case)
+{
+   EXPECT_EQ(u8"hello world", unicode::ToLower("Hello World"));
+   EXPECT_EQ(u8"élan ÿ ǆ", unicode::ToLower(u8"Élan Ÿ ǆ"));
+   EXPECT_EQ(u8"привет ёж", unicode::ToLower(u8"ПРИВЕТ Ёж"));
+   EXPECT_EQ(u8"άλφα", unicode::ToLower(u8"Άλφα"));
+   EXPECT_EQ(U'Ł', unicode::ToUpper(U'ł'));
+   EXPECT_EQ(U'Ÿ', unicode::ToUpper(U'ÿ'));
+   EXPECT_EQ(U'Ж', unicode::ToUpper(U'ж'));
+   EXPECT_EQ(U'÷', unicode::ToUpper(U'÷'));
+   EXPECT_EQ(U'1', unicode::ToLower(U'1'));
+}
+
+TEST(UnicodeTest, Letters)
+{
+   EXPECT_TRUE(unicode::IsLetter(U'z'));
+   EXPECT_TRUE(unicode::IsLetter(U'ñ'));
+   EXPECT_TRUE(unicode::IsLetter(U'ж'));
+   EXPECT_TRUE(unicode::IsLetter(U'漢'));
+   EXPECT_FALSE(unicode::IsLetter(U'—'));
+   EXPECT_FALSE(unicode::IsLetter(U'×'));
+   EXPECT_FALSE(unicode::IsLetter(U'\''));
+   EXPECT_FALSE(unicode::IsLetter(unicode::gc_invalidCodePoint));
+}
+
+TEST(UnicodeTest, Script)
+{
+   EXPECT_EQ(unicode::Script::Latin, unicode::GetScript("word"));
+   EXPECT_EQ(unicode::Script::Latin, unicode::GetScript(u8"naïve"));
+   EXPECT_EQ(unicode::Script::Cyrillic, unicode::GetScript(u8"слово"));
+   EXPECT_EQ(unicode::Script::Greek, unicode::GetScript(u8"λέξη"));
+   EXPECT_EQ(unicode::Script::Any, unicode::GetScript(u8"wordслово"));
+   EXPECT_EQ(unicode::Script::Any, unicode::GetScript("wo?d"));
+   EXPECT_EQ(unicode::Script::Any, unicode::GetScript(""));
+}
+
+}
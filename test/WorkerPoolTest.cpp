@@ -0,0 +1,138 @@
+#include "gtest/gtest.h"
+#include "../WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <future>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace
+{
+
+#ifdef __linux__
+/// <summary>
+/// CPUs the calling thread may run on
+/// </summary>
+WorkerPool::CpuVec getAffinity()
+{
+   cpu_set_t cpuSet;
+   CPU_ZERO(&cpuSet);
+   WorkerPool::CpuVec cpus;
+   if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0)
+   {
+      for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      {
+         if (CPU_ISSET(cpu, &cpuSet))
+         {
+            cpus.push_back(cpu);
+         }
+      }
+   }
+   return cpus;
+}
+#endif
+
+TEST(WorkerPoolTest, Topology)
+{
+   const auto topology = WorkerPool::GetTopology();
+   ASSERT_FALSE(topology.empty());
+   for (const auto& cpus : topology)
+   {
+      EXPECT_FALSE(cpus.empty());
+   }
+}
+
+TEST(WorkerPoolTest, RunTasks)
+{
+   EXPECT_EQ(WorkerPool::sc_noNode, WorkerPool::GetCurrentNode());
+
+   std::atomic<size_t> taskCount{ 0 };
+   std::promise<size_t> node;
+   {
+      auto pool = std::make_shared<WorkerPool>(WorkerPool::Options{ 3, false });
+      EXPECT_EQ(3u, pool->GetThreadCount());
+      EXPECT_EQ(1u, pool->GetNodeCount());
+
+      auto executor = pool->GetExecutor();
+      executor([&node]() { node.set_value(WorkerPool::GetCurrentNode()); });
+      for (size_t i = 0; i < 100; ++i)
+      {
+         pool->Post([&taskCount]() { ++taskCount; });
+      }
+   }
+   EXPECT_EQ(100u, taskCount);
+   EXPECT_EQ(0u, node.get_future().get());
+}
+
+TEST(WorkerPoolTest, TaskDropsLastReference)
+{
+   struct PoolReference
+   {
+      ~PoolReference()
+      {
+         pool.reset();
+         isReleased.set_value(WorkerPool::GetCurrentNode());
+      }
+
+      std::shared_ptr<WorkerPool> pool;
+      std::promise<size_t>& isReleased;
+   };
+
+   std::atomic<size_t> taskCount{ 0 };
+   std::promise<size_t> isReleased;
+   {
+      auto pool = std::make_shared<WorkerPool>(WorkerPool::Options{ 2, false });
+      for (size_t i = 0; i < 100; ++i)
+      {
+         pool->Post([&taskCount]() { ++taskCount; });
+      }
+      std::shared_ptr<PoolReference> reference(new PoolReference{ pool, isReleased });
+      pool->Post([reference]() {});
+   }
+   // the pool is destroyed on its worker, after the other worker has run the queued tasks
+   EXPECT_EQ(0u, isReleased.get_future().get());
+   EXPECT_EQ(100u, taskCount);
+}
+
+TEST(WorkerPoolTest, PinnedThreads)
+{
+   WorkerPool pool({ 2, true });
+   EXPECT_EQ(2u, pool.GetThreadCount());
+   ASSERT_LE(1u, pool.GetNodeCount());
+   ASSERT_LE(pool.GetNodeCount(), WorkerPool::GetTopology().size());
+
+   std::vector<size_t> nodes(pool.GetNodeCount(), WorkerPool::sc_noNode);
+   pool.RunOnEveryNode([&nodes](size_t node)
+   {
+      nodes[node] = WorkerPool::GetCurrentNode();
+   });
+   for (size_t node = 0; node < nodes.size(); ++node)
+   {
+      EXPECT_EQ(node, nodes[node]);
+   }
+
+#ifdef __linux__
+   // threads are pinned before they run anything: a node thread to the CPUs of one node, a worker to one CPU
+   std::vector<WorkerPool::CpuVec> nodeAffinities(pool.GetNodeCount());
+   pool.RunOnEveryNode([&nodeAffinities](size_t node)
+   {
+      nodeAffinities[node] = getAffinity();
+   });
+   const auto topology = WorkerPool::GetTopology();
+   for (const auto& cpus : nodeAffinities)
+   {
+      ASSERT_FALSE(cpus.empty());
+      EXPECT_NE(topology.end(), std::find_if(topology.begin(), topology.end(), [&cpus](const WorkerPool::CpuVec& nodeCpus)
+      {
+         return std::includes(nodeCpus.begin(), nodeCpus.end(), cpus.begin(), cpus.end());
+      }));
+   }
+   std::promise<WorkerPool::CpuVec> workerAffinity;
+   pool.Post([&workerAffinity]() { workerAffinity.set_value(getAffinity()); });
+   EXPECT_EQ(1u, workerAffinity.get_future().get().size());
+#endif
+}
+
+}